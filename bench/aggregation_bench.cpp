@@ -0,0 +1,249 @@
+// Aggregation: per-event cost of on_ticker/on_orderbook with N instruments,
+// snapshot_and_rotate at scale, events/sec as shards are added, and latest()
+// reads and shard writes while the other side runs flat out.
+#include "bench.hpp"
+#include "aggregation/sharded_state.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace strategia::bench {
+
+namespace {
+
+// One price unit at the default scale
+constexpr std::int64_t kUnit = pow10_fixed(FixedScale{}.price);
+
+std::shared_ptr<ShardedState> make_state(std::size_t shards, int instruments) {
+	auto state = std::make_shared<ShardedState>(shards);
+	for (int i = 0; i < instruments; ++i) state->register_instrument(i % 2 ? "okx" : "binance", "SYM" + std::to_string(i));
+	state->start();
+	return state;
+}
+
+// Timed runs end with a rotation, which waits until every posted event is applied
+void add_ticker(int instruments) {
+	add("aggregate/on_ticker/instruments=" + std::to_string(instruments), [instruments] {
+		auto state = make_state(1, instruments);
+		Case c;
+		c.run = [state, instruments](std::uint64_t n) {
+			TickerData t;
+			for (std::uint64_t k = 0; k < n; ++k) {
+				t.instrument = static_cast<InstrumentId>(k % static_cast<std::uint64_t>(instruments));
+				t.price = (64000 + static_cast<std::int64_t>(k & 63)) * kUnit;
+				t.ts_ms = static_cast<std::int64_t>(k);
+				state->on_ticker(t);
+			}
+			state->snapshot_and_rotate(TimeBucket{});
+		};
+		return c;
+	});
+}
+
+void add_orderbook(int instruments) {
+	add("aggregate/on_orderbook/instruments=" + std::to_string(instruments), [instruments] {
+		auto state = make_state(1, instruments);
+		Case c;
+		c.run = [state, instruments](std::uint64_t n) {
+			OrderBookData o;
+			for (int i = 0; i < 5; ++i) {
+				o.bids.push_back({(64000 - i) * kUnit, kUnit});
+				o.asks.push_back({(640005 + 10 * i) * kUnit / 10, kUnit});
+			}
+			for (std::uint64_t k = 0; k < n; ++k) {
+				o.instrument = static_cast<InstrumentId>(k % static_cast<std::uint64_t>(instruments));
+				o.bids.front().price = (64000 - static_cast<std::int64_t>(k & 7)) * kUnit;
+				o.ts_ms = static_cast<std::int64_t>(k);
+				state->on_orderbook(o);
+			}
+			state->snapshot_and_rotate(TimeBucket{});
+		};
+		return c;
+	});
+}
+
+void add_rotate(int instruments) {
+	add("aggregate/snapshot_and_rotate/instruments=" + std::to_string(instruments), [instruments] {
+		auto state = make_state(std::max(1u, std::thread::hardware_concurrency()), instruments);
+		Case c;
+		c.items_per_op = instruments; // rows
+		c.run = [state](std::uint64_t n) {
+			for (std::uint64_t k = 0; k < n; ++k) {
+				auto rows = state->snapshot_and_rotate(TimeBucket{ static_cast<std::int64_t>(k) * kMinuteMs, kMinuteMs });
+				do_not_optimize(rows.data());
+			}
+		};
+		return c;
+	});
+}
+
+// Four producer threads standing in for exchange receive threads
+void add_scaling(std::size_t shards) {
+	add("aggregate/scaling/producers=4/shards=" + std::to_string(shards), [shards] {
+		constexpr int kInstruments = 1000;
+		auto state = make_state(shards, kInstruments);
+		Case c;
+		c.run = [state](std::uint64_t n) {
+			std::vector<std::thread> producers;
+			for (unsigned p = 0; p < 4; ++p) {
+				producers.emplace_back([&, p] {
+					MarketEvent e;
+					e.has_bid = e.has_ask = true;
+					e.bid_price = 100 * kUnit;
+					e.ask_price = 1005 * kUnit / 10;
+					std::uint32_t x = 2463534242u + p;
+					for (std::uint64_t k = p; k < n; k += 4) {
+						x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+						e.instrument = x % kInstruments;
+						e.kind = k & 1 ? MarketEvent::Kind::Ticker : MarketEvent::Kind::Quote;
+						e.price = (100 + static_cast<std::int64_t>(k % 97)) * kUnit;
+						e.ts_ms = static_cast<std::int64_t>(k);
+						state->post(e);
+					}
+				});
+			}
+			for (auto &t : producers) t.join();
+			state->snapshot_and_rotate(TimeBucket{});
+		};
+		return c;
+	});
+}
+
+// Threads running against a timed case until it is destroyed
+struct Contention {
+	std::shared_ptr<ShardedState> state;
+	std::atomic<bool> stop{false};
+	std::vector<std::thread> threads;
+
+	~Contention() {
+		stop.store(true);
+		for (auto &t : threads) t.join();
+	}
+};
+
+constexpr int kLatestInstruments = 1000;
+
+MarketEvent quote_event(std::uint64_t k) {
+	MarketEvent e;
+	e.kind = MarketEvent::Kind::Quote;
+	e.has_bid = e.has_ask = true;
+	e.instrument = static_cast<InstrumentId>(k % kLatestInstruments);
+	e.bid_price = (64000 - static_cast<std::int64_t>(k & 7)) * kUnit;
+	e.bid_amount = kUnit;
+	e.ask_price = (64001 + static_cast<std::int64_t>(k & 7)) * kUnit;
+	e.ask_amount = kUnit;
+	e.ts_ms = static_cast<std::int64_t>(k);
+	return e;
+}
+
+// Strategy threads polling the latest state while a feed keeps the shard busy
+void add_latest_read() {
+	add("aggregate/latest/read/writers=1", [] {
+		auto bg = std::make_shared<Contention>();
+		bg->state = make_state(1, kLatestInstruments);
+		bg->threads.emplace_back([c = bg.get()] {
+			for (std::uint64_t k = 0; !c->stop.load(std::memory_order_relaxed); ++k) c->state->post(quote_event(k));
+		});
+		Case c;
+		c.run = [bg](std::uint64_t n) {
+			InstrumentQuote q;
+			std::uint64_t versions = 0;
+			for (std::uint64_t k = 0; k < n; ++k) {
+				versions += bg->state->latest(static_cast<InstrumentId>(k % kLatestInstruments), q);
+				do_not_optimize(q.bid_price);
+			}
+			do_not_optimize(versions);
+		};
+		return c;
+	});
+}
+
+// The shard's cost of publishing every event while readers hammer the same lines
+void add_latest_write(unsigned readers) {
+	add("aggregate/latest/write/readers=" + std::to_string(readers), [readers] {
+		auto bg = std::make_shared<Contention>();
+		bg->state = make_state(1, kLatestInstruments);
+		for (unsigned r = 0; r < readers; ++r) {
+			bg->threads.emplace_back([c = bg.get(), r] {
+				InstrumentQuote q;
+				for (std::uint64_t k = r; !c->stop.load(std::memory_order_relaxed); ++k) {
+					c->state->latest(static_cast<InstrumentId>(k % kLatestInstruments), q);
+					do_not_optimize(q.bid_price);
+				}
+			});
+		}
+		Case c;
+		c.run = [bg](std::uint64_t n) {
+			for (std::uint64_t k = 0; k < n; ++k) bg->state->post(quote_event(k));
+			bg->state->snapshot_and_rotate(TimeBucket{});
+		};
+		return c;
+	});
+}
+
+// OverflowPolicy::Conflate with a ring of 4 and no workers running, so what
+// overflows is deterministic: an idle instrument's first event must take the
+// ring, an instrument never seen must stay empty, and an overflow must park
+// only the newest event of each instrument
+bool check_conflation() {
+	ShardedState state(1, 4, OverflowPolicy::Conflate);
+	const InstrumentId a = state.register_instrument("binance", "AAA");
+	const InstrumentId b = state.register_instrument("okx", "BBB");
+	// Events stay queued until the rotation, which applies them on this thread
+	state.start();
+	state.stop();
+
+	bool ok = true;
+	auto expect = [&ok](bool holds, const char *what) {
+		if (!holds) std::fprintf(stderr, "conflate: %s\n", what);
+		ok = ok && holds;
+	};
+	auto ticker = [&state](InstrumentId id, std::int64_t price) {
+		TickerData t;
+		t.instrument = id;
+		t.price = price * kUnit;
+		t.ts_ms = 1;
+		state.on_ticker(t);
+	};
+
+	ticker(a, 100);
+	expect(state.queue_stats(0).conflated == 0, "first event of an idle instrument was parked");
+	auto rows = state.snapshot_and_rotate(TimeBucket{0, kMinuteMs});
+	expect(rows.size() == 2, "one row per instrument");
+	if (rows.size() != 2) return false;
+	expect(rows[0].last_price == 100 * kUnit && rows[0].tick_count == 1, "queued ticker not applied once");
+	expect(rows[1].last_price == kNullFixed && rows[1].tick_count == 0, "instrument never seen got a price");
+
+	// 4 fit the ring, the other 6 of a share one slot, b's parks in its own
+	for (int k = 1; k <= 10; ++k) ticker(a, 100 + k);
+	ticker(b, 50);
+	expect(state.queue_stats(0).conflated == 7, "conflated count is not the 7 overflowed events");
+	rows = state.snapshot_and_rotate(TimeBucket{kMinuteMs, kMinuteMs});
+	expect(rows.size() == 2, "one row per instrument");
+	if (rows.size() != 2) return false;
+	expect(rows[0].last_price == 110 * kUnit && rows[0].tick_count == 5, "newest parked ticker lost or applied twice");
+	expect(rows[1].last_price == 50 * kUnit && rows[1].tick_count == 1, "parked ticker of another instrument lost");
+	return ok;
+}
+
+}
+
+void register_aggregation_benchmarks() {
+	for (int n : {1, 1000, 100000}) add_ticker(n);
+	for (int n : {1, 1000, 100000}) add_orderbook(n);
+	for (int n : {1000, 100000}) add_rotate(n);
+	const std::size_t max_shards = std::max(1u, std::thread::hardware_concurrency());
+	for (std::size_t shards = 1; shards <= max_shards; shards *= 2) add_scaling(shards);
+	if ((max_shards & (max_shards - 1)) != 0) add_scaling(max_shards);
+	add_latest_read();
+	for (unsigned readers : {0u, 2u}) add_latest_write(readers);
+}
+
+void register_aggregation_checks() {
+	add_check("aggregate/conflate", check_conflation);
+}
+
+}
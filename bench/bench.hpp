@@ -0,0 +1,44 @@
+#pragma once
+
+// Minimal benchmark harness for strategia_bench. A benchmark's setup runs
+// once, untimed, and returns a Case whose run(n) performs n operations; the
+// harness grows n until a run lasts --min-time and reports that run.
+// With --check it runs the registered checks instead and exits non-zero if
+// any fails; ctest runs it that way.
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace strategia::bench {
+
+struct Case {
+	std::function<void(std::uint64_t n)> run;
+	double items_per_op = 1.0; // rows, events, ... for items_per_sec
+};
+
+void add(std::string name, std::function<Case()> setup);
+
+// A correctness check; prints what differed to stderr and returns false on failure
+void add_check(std::string name, std::function<bool()> check);
+
+// Heap allocations so far, by any thread of the process
+std::uint64_t allocations();
+
+// Keeps the compiler from discarding a computed value
+template<typename T>
+inline void do_not_optimize(const T &value) {
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+void register_parse_benchmarks();
+void register_aggregation_benchmarks();
+void register_storage_benchmarks();
+void register_feed_benchmarks();
+void register_shm_benchmarks();
+void register_parse_checks();
+void register_feed_checks();
+void register_aggregation_checks();
+void register_http_checks(); // none without the libcurl REST client
+
+}
@@ -0,0 +1,152 @@
+// strategia_bench [--filter SUBSTR] [--min-time SECONDS] [--format json|csv] [--check]
+// Prints one record per benchmark: ns/op, heap allocations/op, items/sec.
+// --check runs the correctness checks instead: one line each, exit 1 on a failure.
+#include "bench.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::atomic<std::uint64_t> g_allocations{0};
+
+struct Entry {
+	std::string name;
+	std::function<strategia::bench::Case()> setup;
+};
+
+std::vector<Entry> &registry() {
+	static std::vector<Entry> entries;
+	return entries;
+}
+
+struct Check {
+	std::string name;
+	std::function<bool()> run;
+};
+
+std::vector<Check> &checks() {
+	static std::vector<Check> entries;
+	return entries;
+}
+
+}
+
+// Counts every heap allocation in the process, including worker threads
+void *operator new(std::size_t size) {
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void *p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+void *operator new[](std::size_t size) { return operator new(size); }
+void *operator new(std::size_t size, std::align_val_t align) {
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	const auto a = static_cast<std::size_t>(align);
+	if (void *p = std::aligned_alloc(a, (size + a - 1) / a * a)) return p;
+	throw std::bad_alloc();
+}
+void *operator new[](std::size_t size, std::align_val_t align) { return operator new(size, align); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace strategia::bench {
+
+void add(std::string name, std::function<Case()> setup) {
+	registry().push_back({std::move(name), std::move(setup)});
+}
+
+void add_check(std::string name, std::function<bool()> check) {
+	checks().push_back({std::move(name), std::move(check)});
+}
+
+std::uint64_t allocations() {
+	return g_allocations.load(std::memory_order_relaxed);
+}
+
+}
+
+int main(int argc, char **argv) {
+	std::string filter;
+	double min_time = 0.5;
+	bool csv = false;
+	bool check = false;
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		if (arg == "--filter" && i + 1 < argc) filter = argv[++i];
+		else if (arg == "--min-time" && i + 1 < argc) min_time = std::atof(argv[++i]);
+		else if (arg == "--format" && i + 1 < argc) csv = std::string(argv[++i]) == "csv";
+		else if (arg == "--check") check = true;
+		else {
+			std::fprintf(stderr, "usage: strategia_bench [--filter SUBSTR] [--min-time SECONDS] [--format json|csv] [--check]\n");
+			return 2;
+		}
+	}
+
+	strategia::bench::register_parse_benchmarks();
+	strategia::bench::register_aggregation_benchmarks();
+	strategia::bench::register_storage_benchmarks();
+	strategia::bench::register_feed_benchmarks();
+	strategia::bench::register_shm_benchmarks();
+	strategia::bench::register_parse_checks();
+	strategia::bench::register_feed_checks();
+	strategia::bench::register_aggregation_checks();
+	strategia::bench::register_http_checks();
+
+	if (check) {
+		int failed = 0;
+		for (const auto &c : checks()) {
+			if (!filter.empty() && c.name.find(filter) == std::string::npos) continue;
+			const bool ok = c.run();
+			std::printf("%s %s\n", ok ? "ok  " : "FAIL", c.name.c_str());
+			std::fflush(stdout);
+			if (!ok) ++failed;
+		}
+		return failed == 0 ? 0 : 1;
+	}
+
+	if (csv) std::printf("name,iterations,ns_per_op,allocs_per_op,items_per_sec\n");
+	for (const auto &entry : registry()) {
+		if (!filter.empty() && entry.name.find(filter) == std::string::npos) continue;
+		const strategia::bench::Case c = entry.setup();
+		c.run(1); // warm caches and lazily grown buffers
+
+		std::uint64_t n = 1;
+		double secs = 0.0;
+		std::uint64_t allocs = 0;
+		for (;;) {
+			const std::uint64_t a0 = g_allocations.load(std::memory_order_relaxed);
+			const auto t0 = std::chrono::steady_clock::now();
+			c.run(n);
+			secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+			allocs = g_allocations.load(std::memory_order_relaxed) - a0;
+			if (secs >= min_time || n >= (std::uint64_t{1} << 40)) break;
+			// Aim a little past min_time, growing at most 10x per step
+			const double scale = secs > 0.0 ? min_time * 1.2 / secs : 10.0;
+			n = static_cast<std::uint64_t>(static_cast<double>(n) * std::min(std::max(scale, 2.0), 10.0));
+		}
+
+		const double ops = static_cast<double>(n);
+		const double ns_per_op = secs * 1e9 / ops;
+		const double allocs_per_op = static_cast<double>(allocs) / ops;
+		const double items_per_sec = ops * c.items_per_op / secs;
+		if (csv) {
+			std::printf("%s,%llu,%.2f,%.3f,%.0f\n", entry.name.c_str(), static_cast<unsigned long long>(n),
+				ns_per_op, allocs_per_op, items_per_sec);
+		} else {
+			std::printf("{\"name\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.2f,\"allocs_per_op\":%.3f,\"items_per_sec\":%.0f}\n",
+				entry.name.c_str(), static_cast<unsigned long long>(n), ns_per_op, allocs_per_op, items_per_sec);
+		}
+		std::fflush(stdout);
+	}
+	return 0;
+}
@@ -0,0 +1,150 @@
+// Receive path: a raw frame through an exchange client's parser and local
+// book into the aggregation shard, as a receive thread runs it. The number to
+// watch is allocs_per_op, which should be 0: events are plain values and every
+// buffer on the way is reused. The feed/*/no_alloc checks enforce it.
+#include "bench.hpp"
+#include "aggregation/aggregation_sink.hpp"
+#include "exchanges/binance_client.hpp"
+#include "exchanges/okx_client.hpp"
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace strategia::bench {
+
+namespace {
+
+const char *kBinanceTicker =
+	R"({"stream":"btcusdt@ticker","data":{"e":"24hrTicker","E":1724000000123,"s":"BTCUSDT",)"
+	R"("c":"64300.01000000","b":"64300.00000000","a":"64300.01000000","v":"21933.65745000"}})";
+
+const char *kOkxTicker =
+	R"({"arg":{"channel":"tickers","instId":"BTC-USDT"},"data":[{"instType":"SPOT","instId":"BTC-USDT",)"
+	R"("last":"64300.1","askPx":"64300.1","askSz":"0.8","bidPx":"64300","bidSz":"1.2","ts":"1724000000123"}]})";
+
+// One diff per frame; U and u are rewritten in place so the stream stays in sequence
+const char *kBinanceDepth =
+	R"({"stream":"btcusdt@depth@100ms","data":{"e":"depthUpdate","E":1724000000123,"s":"BTCUSDT",)"
+	R"("U":000000000000,"u":000000000000,"b":[["64300.00000000","1.50000000"],["64299.00000000","0.20000000"]],)"
+	R"("a":[["64300.01000000","0.70000000"],["64301.00000000","2.10000000"]]}})";
+
+const char *kBinanceSnapshot =
+	"BTCUSDT\n"
+	R"({"lastUpdateId":1000,"bids":[["64300.00000000","1.0"],["64299.00000000","1.0"]],)"
+	R"("asks":[["64300.01000000","1.0"],["64301.00000000","1.0"]]})";
+
+struct Feed {
+	std::shared_ptr<ShardedState> state = std::make_shared<ShardedState>(1);
+	std::unique_ptr<BinanceClient<AggregationSink>> binance;
+	std::unique_ptr<OkxClient<AggregationSink>> okx;
+
+	Feed() {
+		const AggregationSink sink{state.get()};
+		binance = std::make_unique<BinanceClient<AggregationSink>>(
+			std::vector<Subscription>{{"BTCUSDT", state->register_instrument("binance", "BTCUSDT"), FixedScale{}}}, sink);
+		okx = std::make_unique<OkxClient<AggregationSink>>(
+			std::vector<Subscription>{{"BTC-USDT", state->register_instrument("okx", "BTC-USDT"), FixedScale{}}}, sink);
+		state->start();
+	}
+
+	// Every posted event has been taken off the ring
+	void wait_drained() const {
+		while (state->queue_stats(0).depth != 0) std::this_thread::yield();
+	}
+};
+
+// Diffs for feed/binance_depth, in sequence after kBinanceSnapshot
+struct DepthStream {
+	std::string text = kBinanceDepth;
+	std::size_t first = text.find("\"U\":") + 4;
+	std::size_t last = text.find("\"u\":") + 4;
+	std::int64_t next_id = 1001;
+
+	const std::string &next() {
+		char digits[13];
+		std::snprintf(digits, sizeof(digits), "%012lld", static_cast<long long>(next_id++));
+		text.replace(first, 12, digits, 12);
+		text.replace(last, 12, digits, 12);
+		return text;
+	}
+};
+
+constexpr int kWarmupFrames = 1000;
+constexpr int kCheckedFrames = 10000;
+
+// Fails if frames allocate once warm, counting the shard worker as well.
+// Rotation is left out: it builds the bucket's rows.
+bool no_allocations(const std::string &name, Feed &feed, const std::function<void()> &frame) {
+	for (int k = 0; k < kWarmupFrames; ++k) frame();
+	feed.wait_drained();
+	const std::uint64_t before = allocations();
+	for (int k = 0; k < kCheckedFrames; ++k) frame();
+	feed.wait_drained();
+	const std::uint64_t allocs = allocations() - before;
+	if (allocs != 0) {
+		std::fprintf(stderr, "%s: %llu allocation(s) over %d frames after warm-up\n",
+			name.c_str(), static_cast<unsigned long long>(allocs), kCheckedFrames);
+	}
+	return allocs == 0;
+}
+
+// Timed runs end with a rotation, which waits until every posted event is applied
+void add_frames(const std::string &name, const char *frame, bool binance) {
+	add("feed/" + name, [frame, binance] {
+		auto feed = std::make_shared<Feed>();
+		auto text = std::make_shared<std::string>(frame);
+		Case c;
+		c.run = [feed, text, binance](std::uint64_t n) {
+			for (std::uint64_t k = 0; k < n; ++k) {
+				if (binance) feed->binance->replay_frame(*text);
+				else feed->okx->replay_frame(*text);
+			}
+			feed->state->snapshot_and_rotate(TimeBucket{});
+		};
+		return c;
+	});
+}
+
+void add_binance_depth() {
+	add("feed/binance_depth", [] {
+		auto feed = std::make_shared<Feed>();
+		feed->binance->replay_snapshot(kBinanceSnapshot);
+		auto stream = std::make_shared<DepthStream>();
+		Case c;
+		c.run = [feed, stream](std::uint64_t n) {
+			for (std::uint64_t k = 0; k < n; ++k) feed->binance->replay_frame(stream->next());
+			feed->state->snapshot_and_rotate(TimeBucket{});
+		};
+		return c;
+	});
+}
+
+}
+
+void register_feed_benchmarks() {
+	add_frames("binance_ticker", kBinanceTicker, true);
+	add_frames("okx_ticker", kOkxTicker, false);
+	add_binance_depth();
+}
+
+void register_feed_checks() {
+	add_check("feed/binance_ticker/no_alloc", [] {
+		Feed feed;
+		const std::string text = kBinanceTicker;
+		return no_allocations("feed/binance_ticker", feed, [&] { feed.binance->replay_frame(text); });
+	});
+	add_check("feed/okx_ticker/no_alloc", [] {
+		Feed feed;
+		const std::string text = kOkxTicker;
+		return no_allocations("feed/okx_ticker", feed, [&] { feed.okx->replay_frame(text); });
+	});
+	add_check("feed/binance_depth/no_alloc", [] {
+		Feed feed;
+		feed.binance->replay_snapshot(kBinanceSnapshot);
+		DepthStream stream;
+		return no_allocations("feed/binance_depth", feed, [&] { feed.binance->replay_frame(stream.next()); });
+	});
+}
+
+}
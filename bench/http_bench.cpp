@@ -0,0 +1,203 @@
+// Pooled HTTP client against a loopback stand-in: fetch_all's deadline
+// cutoff, bodies and status codes as backfill_missing reads them, and
+// connection reuse through the CURLSH share. Checks only; the client's cost
+// is the network's.
+#include "bench.hpp"
+#ifdef STRATEGIA_USE_LIBCURL_REST
+#include "http/http_client.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace strategia::bench {
+
+#ifdef STRATEGIA_USE_LIBCURL_REST
+
+namespace {
+
+constexpr int kPollMs = 20;
+constexpr auto kSlowDelay = std::chrono::milliseconds(1500);
+constexpr auto kDeadline = std::chrono::milliseconds(300);
+
+// Large enough to arrive in several reads
+std::string expected_body() {
+	std::string body;
+	for (int i = 0; body.size() < 200000; ++i) body += "row " + std::to_string(i) + "\n";
+	return body;
+}
+
+// Keep-alive HTTP/1.1 on 127.0.0.1, a thread per connection:
+//   GET /body  200 with expected_body()
+//   GET /slow  200 after kSlowDelay
+//   otherwise  404
+class StandIn {
+public:
+	StandIn() : body_(expected_body()) {
+		fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (fd_ < 0) throw std::runtime_error("stand-in socket");
+		sockaddr_in addr{};
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		socklen_t len = sizeof(addr);
+		if (::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd_, 16) != 0
+			|| ::getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+			::close(fd_);
+			throw std::runtime_error("stand-in listen");
+		}
+		port_ = ntohs(addr.sin_port);
+		accept_thread_ = std::thread([this] { serve(); });
+	}
+
+	~StandIn() {
+		running_.store(false);
+		accept_thread_.join();
+		for (auto &t : connections_) t.join();
+		::close(fd_);
+	}
+
+	std::string url(const char *path) const { return "http://127.0.0.1:" + std::to_string(port_) + path; }
+	int accepted() const { return accepted_.load(); }
+	const std::string &body() const { return body_; }
+
+private:
+	void serve() {
+		while (running_.load()) {
+			pollfd p{fd_, POLLIN, 0};
+			if (::poll(&p, 1, kPollMs) <= 0) continue;
+			const int client = ::accept4(fd_, nullptr, nullptr, SOCK_CLOEXEC);
+			if (client < 0) continue;
+			accepted_.fetch_add(1);
+			connections_.emplace_back([this, client] {
+				handle(client);
+				::close(client);
+			});
+		}
+	}
+
+	// Requests on one connection until the client closes it or we stop
+	void handle(int client) {
+		std::string in;
+		char buf[4096];
+		while (running_.load()) {
+			const std::size_t end = in.find("\r\n\r\n");
+			if (end == std::string::npos) {
+				pollfd p{client, POLLIN, 0};
+				if (::poll(&p, 1, kPollMs) <= 0) continue;
+				const ssize_t n = ::recv(client, buf, sizeof(buf), 0);
+				if (n <= 0) return;
+				in.append(buf, static_cast<std::size_t>(n));
+				continue;
+			}
+			const std::string line = in.substr(0, in.find("\r\n"));
+			in.erase(0, end + 4);
+			if (line.rfind("GET /slow ", 0) == 0) {
+				const auto until = std::chrono::steady_clock::now() + kSlowDelay;
+				while (running_.load() && std::chrono::steady_clock::now() < until) {
+					std::this_thread::sleep_for(std::chrono::milliseconds(kPollMs));
+				}
+				if (!send_all(client, response("200 OK", "slow\n"))) return;
+			} else if (line.rfind("GET /body ", 0) == 0) {
+				if (!send_all(client, response("200 OK", body_))) return;
+			} else if (!send_all(client, response("404 Not Found", "not found\n"))) {
+				return;
+			}
+		}
+	}
+
+	static std::string response(const char *status, const std::string &body) {
+		return std::string("HTTP/1.1 ") + status + "\r\nContent-Type: text/plain\r\nContent-Length: "
+			+ std::to_string(body.size()) + "\r\n\r\n" + body;
+	}
+
+	static bool send_all(int fd, const std::string &data) {
+		std::size_t sent = 0;
+		while (sent < data.size()) {
+			const ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+			if (n <= 0) return false;
+			sent += static_cast<std::size_t>(n);
+		}
+		return true;
+	}
+
+	std::string body_;
+	int fd_ = -1;
+	std::uint16_t port_ = 0;
+	std::atomic<bool> running_{true};
+	std::atomic<int> accepted_{0};
+	std::thread accept_thread_;
+	std::vector<std::thread> connections_; // accept thread only, then the destructor
+};
+
+// A batch as backfill_missing issues it: what finished is read, what is late is abandoned
+bool check_fetch_all() {
+	StandIn server;
+	HttpClient client;
+	std::vector<HttpRequest> requests(3);
+	requests[0].url = server.url("/body");
+	requests[1].url = server.url("/slow");
+	requests[2].url = server.url("/missing");
+	const auto started = std::chrono::steady_clock::now();
+	client.fetch_all(requests, started + kDeadline);
+	const auto took = std::chrono::steady_clock::now() - started;
+
+	bool ok = true;
+	auto expect = [&ok](bool holds, const char *what) {
+		if (!holds) std::fprintf(stderr, "http/fetch_all: %s\n", what);
+		ok = ok && holds;
+	};
+	expect(requests[0].completed && requests[0].status_code == 200, "200 response not completed");
+	expect(requests[0].body == server.body(), "body arrived altered");
+	expect(requests[2].completed && requests[2].status_code == 404, "404 response not completed with its status");
+	expect(!requests[1].completed, "response delayed past the deadline counted as completed");
+	expect(took < kSlowDelay, "fetch_all waited past its deadline");
+	return ok;
+}
+
+// Handles are not pooled here, so the second request can only find the
+// first one's connection through the share
+bool check_reuse() {
+	StandIn server;
+	HttpOptions opts;
+	opts.max_idle_handles = 0;
+	HttpClient client(opts);
+	long status = 0;
+	HttpTiming first, second;
+	const std::string a = client.fetch(server.url("/body"), status, &first);
+	const std::string b = client.fetch(server.url("/body"), status, &second);
+
+	bool ok = true;
+	auto expect = [&ok](bool holds, const char *what) {
+		if (!holds) std::fprintf(stderr, "http/reuse: %s\n", what);
+		ok = ok && holds;
+	};
+	expect(status == 200 && a == server.body() && b == server.body(), "bodies or status wrong");
+	expect(!first.reused_connection, "first request claims a reused connection");
+	expect(second.reused_connection, "second request did not reuse the connection");
+	expect(server.accepted() == 1, "second request opened a connection");
+	return ok;
+}
+
+}
+
+void register_http_checks() {
+	add_check("http/fetch_all", check_fetch_all);
+	add_check("http/reuse", check_reuse);
+}
+
+#else
+
+void register_http_checks() {}
+
+#endif
+
+}
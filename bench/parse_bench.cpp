@@ -0,0 +1,308 @@
+// Frame parsing: synthetic frames shaped like the live feeds, plus frames
+// from a recorded journal when STRATEGIA_BENCH_JOURNAL names its directory.
+// The parity checks run the same frames through both parsers and fail on
+// any field the fast path reads differently from the nlohmann reference.
+// The book checks feed parsed frames to the OKX checksum and Binance
+// snapshot alignment and fail on a wrong resync decision.
+#include "bench.hpp"
+#include "book/book_sync.hpp"
+#include "exchanges/frame_parser.hpp"
+#include "journal/frame_journal.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <vector>
+
+namespace strategia::bench {
+
+namespace {
+
+const char *kBinanceTicker =
+	R"({"stream":"btcusdt@ticker","data":{"e":"24hrTicker","E":1724000000123,"s":"BTCUSDT","p":"-512.01000000",)"
+	R"("P":"-0.790","w":"64420.87364219","x":"64812.00000000","c":"64300.01000000","Q":"0.00120000",)"
+	R"("b":"64300.00000000","B":"3.81214000","a":"64300.01000000","A":"0.26180000","o":"64812.02000000",)"
+	R"("h":"65049.99000000","l":"63800.00000000","v":"21933.65745000","q":"1412950843.57810680",)"
+	R"("O":1723913700123,"C":1724000100123,"F":3746284411,"L":3747455917,"n":1171507}})";
+
+const char *kOkxTicker =
+	R"({"arg":{"channel":"tickers","instId":"BTC-USDT"},"data":[{"instType":"SPOT","instId":"BTC-USDT",)"
+	R"("last":"64300.1","lastSz":"0.00012","askPx":"64300.1","askSz":"0.8","bidPx":"64300","bidSz":"1.2",)"
+	R"("open24h":"64812","high24h":"65050","low24h":"63800","sodUtc0":"64500","sodUtc8":"64700",)"
+	R"("volCcy24h":"1412950843.57","vol24h":"21933.65","ts":"1724000000123"}]})";
+
+std::string binance_depth(int levels) {
+	std::string f = R"({"stream":"btcusdt@depth@100ms","data":{"e":"depthUpdate","E":1724000000123,"s":"BTCUSDT",)"
+		R"("U":51234567890,"u":51234567912,"b":[)";
+	for (int i = 0; i < levels; ++i) {
+		if (i) f += ',';
+		f += "[\"6430" + std::to_string(i % 10) + ".00000000\",\"0." + std::to_string(100 + i) + "00000\"]";
+	}
+	f += R"(],"a":[)";
+	for (int i = 0; i < levels; ++i) {
+		if (i) f += ',';
+		f += "[\"6431" + std::to_string(i % 10) + ".01000000\",\"1." + std::to_string(200 + i) + "00000\"]";
+	}
+	return f + "]}}";
+}
+
+std::string okx_books(int levels) {
+	std::string f = R"({"arg":{"channel":"books","instId":"BTC-USDT"},"action":"update","data":[{"asks":[)";
+	for (int i = 0; i < levels; ++i) {
+		if (i) f += ',';
+		f += "[\"6431" + std::to_string(i % 10) + ".1\",\"0." + std::to_string(300 + i) + "\",\"0\",\"" + std::to_string(1 + i % 4) + "\"]";
+	}
+	f += R"(],"bids":[)";
+	for (int i = 0; i < levels; ++i) {
+		if (i) f += ',';
+		f += "[\"6430" + std::to_string(i % 10) + ".9\",\"1." + std::to_string(400 + i) + "\",\"0\",\"" + std::to_string(1 + i % 3) + "\"]";
+	}
+	return f + R"(],"ts":"1724000000123","checksum":-1881014294,"prevSeqId":123456789,"seqId":123456790}]})";
+}
+
+// Edge cases the live feeds send besides the shapes above
+const char *kBinanceDepthOneSided =
+	R"({"stream":"ethusdt@depth@100ms","data":{"e":"depthUpdate","E":1724000000456,"s":"ETHUSDT",)"
+	R"("U":700,"u":702,"b":[],"a":[["2650.10","0.00000000"]]}})";
+const char *kOkxSnapshot =
+	R"({"arg":{"channel":"books","instId":"ETH-USDT"},"action":"snapshot","data":[{"asks":[["2650.1","3","0","2"]],)"
+	R"("bids":[["2650","0.5","0","1"],["2649.9","12.25","0","4"]],"ts":"1724000000456","checksum":12345,)"
+	R"("prevSeqId":-1,"seqId":9000}]})";
+const char *kOkxAck = R"({"event":"subscribe","arg":{"channel":"tickers","instId":"BTC-USDT"},"connId":"a4d3ae55"})";
+const char *kBinanceOtherEvent =
+	R"({"stream":"btcusdt@aggTrade","data":{"e":"aggTrade","E":1724000000789,"s":"BTCUSDT","p":"64300.01","q":"0.1"}})";
+
+using Parser = void (*)(const std::string &, ParsedFrame &);
+using FastParser = bool (*)(std::string_view, ParsedFrame &);
+
+bool same_levels(const std::vector<LevelUpdate> &a, const std::vector<LevelUpdate> &b) {
+	if (a.size() != b.size()) return false;
+	for (std::size_t i = 0; i < a.size(); ++i) {
+		if (a[i].price_text != b[i].price_text || a[i].amount_text != b[i].amount_text) return false;
+	}
+	return true;
+}
+
+// First field the two parses disagree on, nullptr when they match
+const char *frame_difference(const ParsedFrame &fast, const ParsedFrame &ref) {
+	if (fast.kind != ref.kind) return "kind";
+	if (fast.symbol != ref.symbol) return "symbol";
+	if (fast.kind == FrameKind::Ticker) {
+		if (fast.ticker.ts_ms != ref.ticker.ts_ms) return "ticker ts";
+		if (fast.ticker_price != ref.ticker_price) return "ticker price";
+	} else if (fast.kind == FrameKind::BookUpdate) {
+		const BookUpdate &a = fast.update;
+		const BookUpdate &b = ref.update;
+		if (a.ts_ms != b.ts_ms) return "book ts";
+		if (a.snapshot != b.snapshot) return "snapshot";
+		if (a.first_update_id != b.first_update_id || a.last_update_id != b.last_update_id) return "update ids";
+		if (a.has_checksum != b.has_checksum || a.checksum != b.checksum) return "checksum";
+		if (!same_levels(a.bids, b.bids)) return "bids";
+		if (!same_levels(a.asks, b.asks)) return "asks";
+	}
+	return nullptr;
+}
+
+// Frames the fast path rejects go to the reference parser anyway and have
+// nothing to compare; samples must all take the fast path.
+bool check_parity(const char *name, const std::vector<std::string> &frames, FastParser fast, Parser ref, bool samples) {
+	ParsedFrame a, b;
+	std::size_t fallback = 0;
+	std::size_t failures = 0;
+	for (std::size_t i = 0; i < frames.size(); ++i) {
+		const std::string &f = frames[i];
+		const char *diff = nullptr;
+		if (!fast(f, a)) {
+			++fallback;
+			if (samples) diff = "fast path rejected a sample";
+		} else {
+			try {
+				ref(f, b);
+				diff = frame_difference(a, b);
+			} catch (const std::exception &) {
+				diff = "reference parser rejected a frame the fast path accepted";
+			}
+		}
+		if (diff && ++failures <= 10) std::fprintf(stderr, "%s frame %zu: %s differs\n  %s\n", name, i, diff, f.c_str());
+	}
+	std::fprintf(stderr, "%s: %zu frames, %zu on the fallback path, %zu mismatched\n", name, frames.size(), fallback, failures);
+	return failures == 0;
+}
+
+// Book resync logic, through the real parsers so the level text and update
+// ids arrive as in production. A wrong checksum string or alignment rule
+// would resync on every frame live.
+struct BookCheck {
+	const char *name;
+	bool ok = true;
+	ParsedFrame frame;
+
+	void expect(bool holds, const char *what) {
+		if (!holds) std::fprintf(stderr, "%s: %s\n", name, what);
+		ok = ok && holds;
+	}
+
+	const BookUpdate &parse(const std::string &text, Parser parser) {
+		parser(text, frame);
+		expect(frame.kind == FrameKind::BookUpdate && scale_frame(frame, FixedScale{}), "frame did not parse");
+		return frame.update;
+	}
+};
+
+std::int64_t fixed_price(double v) {
+	return static_cast<std::int64_t>(v * static_cast<double>(pow10_fixed(FixedScale{}.price)) + 0.5);
+}
+
+std::string okx_book(const char *action, const char *bids, const char *asks, std::int64_t prev, std::int64_t seq,
+	std::int32_t checksum) {
+	return std::string(R"({"arg":{"channel":"books","instId":"ETH-USDT"},"action":")") + action
+		+ R"(","data":[{"asks":)" + asks + R"(,"bids":)" + bids + R"(,"ts":"1724000000123","checksum":)"
+		+ std::to_string(checksum) + R"(,"prevSeqId":)" + std::to_string(prev) + R"(,"seqId":)" + std::to_string(seq) + "}]}";
+}
+
+// The example book of the OKX docs and updates to it. Checksums are zlib
+// CRC32s of the strings in the comments, as signed 32-bit integers.
+bool check_okx_book() {
+	BookCheck c{"book/okx_checksum"};
+	OkxBookSync sync;
+	auto update = [&](const std::string &text) { return sync.on_update(c.parse(text, parse_okx_frame)); };
+	// "3366.1:7:3366.8:9:3366:6:3368:8"
+	const std::string snapshot = okx_book("snapshot", R"([["3366.1","7","0","3"],["3366","6","3","4"]])",
+		R"([["3366.8","9","10","3"],["3368","8","3","4"]])", -1, 10, -1881014294);
+
+	c.expect(update(okx_book("update", R"([["3366.1","8","0","1"]])", "[]", 9, 10, 0)) == BookSyncStatus::Pending,
+		"update before the snapshot not held back");
+	c.expect(update(snapshot) == BookSyncStatus::Applied, "docs example checksum rejected");
+	// "...:3365.5:1.50:3368.5:0.10", amounts as sent, trailing zeros included
+	c.expect(update(okx_book("update", R"([["3365.5","1.50","0","1"]])", R"([["3368.5","0.10","0","1"]])", 10, 11, -955460062))
+		== BookSyncStatus::Applied, "checksum over the sent text rejected");
+	// "...:3365.5:1.50", three bids and two asks interleave until the asks run out
+	c.expect(update(okx_book("update", "[]", R"([["3368.5","0","0","0"]])", 11, 12, 551308115)) == BookSyncStatus::Applied,
+		"checksum over uneven sides rejected");
+	c.expect(sync.book().bids().size() == 3 && sync.book().asks().size() == 2, "levels not applied");
+	c.expect(sync.book().bids().level(0).price == fixed_price(3366.1) && sync.book().asks().level(0).price == fixed_price(3366.8),
+		"wrong top of book");
+
+	c.expect(update(okx_book("update", R"([["3365","1","0","1"]])", "[]", 12, 13, 551308115)) == BookSyncStatus::Resync,
+		"stale checksum not caught");
+	c.expect(!sync.synced() && sync.book().bids().empty(), "book kept after a checksum mismatch");
+	c.expect(update(snapshot) == BookSyncStatus::Applied, "no recovery on a new snapshot");
+	c.expect(update(okx_book("update", "[]", "[]", 11, 12, -1881014294)) == BookSyncStatus::Resync, "seqId gap not caught");
+	return c.ok;
+}
+
+std::string binance_diff(std::int64_t first, std::int64_t last, const char *bids, const char *asks) {
+	return R"({"stream":"btcusdt@depth@100ms","data":{"e":"depthUpdate","E":1724000000123,"s":"BTCUSDT","U":)"
+		+ std::to_string(first) + R"(,"u":)" + std::to_string(last) + R"(,"b":)" + bids + R"(,"a":)" + asks + "}}";
+}
+
+// Diffs buffered ahead of the snapshot, the U <= lastUpdateId + 1 <= u
+// bridge, stale diffs, a gap that must refetch and a snapshot too old to use
+bool check_binance_book() {
+	BookCheck c{"book/binance_sync"};
+	BinanceBookSync sync;
+	const std::vector<OrderBookLevel> bids = {{fixed_price(100.0), fixed_price(1.0)}};
+	const std::vector<OrderBookLevel> asks = {{fixed_price(101.0), fixed_price(1.0)}};
+	auto diff = [&](std::int64_t first, std::int64_t last, const char *b) {
+		return sync.on_update(c.parse(binance_diff(first, last, b, "[]"), parse_binance_frame));
+	};
+	auto best_bid = [&] { return sync.book().bids().empty() ? 0 : sync.book().bids().level(0).price; };
+
+	c.expect(diff(101, 102, R"([["99.5","1"]])") == BookSyncStatus::NeedSnapshot, "first diff did not ask for a snapshot");
+	c.expect(diff(103, 105, R"([["100.5","2"]])") == BookSyncStatus::Pending, "snapshot requested twice");
+	// 101-102 is covered by the snapshot; 103-105 bridges it
+	c.expect(sync.on_snapshot(102, bids, asks) == BookSyncStatus::Applied && sync.synced(), "snapshot not bridged");
+	c.expect(best_bid() == fixed_price(100.5) && sync.book().bids().size() == 2, "buffered diffs misapplied");
+	c.expect(diff(104, 105, R"([["100.7","1"]])") == BookSyncStatus::Pending, "stale diff applied");
+	c.expect(diff(106, 107, R"([["100.5","0"]])") == BookSyncStatus::Applied, "next diff not applied");
+	c.expect(best_bid() == fixed_price(100.0), "level removal lost");
+
+	c.expect(diff(110, 111, R"([["100.8","1"]])") == BookSyncStatus::NeedSnapshot, "gap did not ask for a snapshot");
+	c.expect(!sync.synced(), "book still synced across a gap");
+	c.expect(diff(112, 113, R"([["100.9","1"]])") == BookSyncStatus::Pending, "snapshot requested twice after a gap");
+	c.expect(sync.on_snapshot(105, bids, asks) == BookSyncStatus::NeedSnapshot, "snapshot older than the buffer accepted");
+	c.expect(sync.on_snapshot(111, bids, asks) == BookSyncStatus::Applied && sync.synced(), "refetched snapshot not bridged");
+	c.expect(best_bid() == fixed_price(100.9), "diffs after the refetched snapshot misapplied");
+	return c.ok;
+}
+
+void parse_fast_binance(const std::string &f, ParsedFrame &out) { parse_binance_frame_fast(f, out); }
+void parse_fast_okx(const std::string &f, ParsedFrame &out) { parse_okx_frame_fast(f, out); }
+
+// Parses the frames round-robin; items are bytes so items_per_sec reads as bytes/sec
+void add_parse(const std::string &name, std::vector<std::string> frames, Parser parse) {
+	add(name, [frames = std::move(frames), parse] {
+		auto out = std::make_shared<ParsedFrame>();
+		double bytes = 0;
+		for (const auto &f : frames) bytes += static_cast<double>(f.size());
+		Case c;
+		c.items_per_op = bytes / static_cast<double>(frames.size());
+		c.run = [frames, parse, out](std::uint64_t n) {
+			std::size_t i = 0;
+			for (std::uint64_t k = 0; k < n; ++k) {
+				parse(frames[i], *out);
+				do_not_optimize(out->kind);
+				if (++i == frames.size()) i = 0;
+			}
+		};
+		return c;
+	});
+}
+
+}
+
+void register_parse_benchmarks() {
+	const std::string depth = binance_depth(20);
+	const std::string books = okx_books(10);
+	add_parse("parse/binance_ticker/fast", {kBinanceTicker}, parse_fast_binance);
+	add_parse("parse/binance_ticker/json", {kBinanceTicker}, parse_binance_frame_json);
+	add_parse("parse/binance_depth20/fast", {depth}, parse_fast_binance);
+	add_parse("parse/binance_depth20/json", {depth}, parse_binance_frame_json);
+	add_parse("parse/okx_ticker/fast", {kOkxTicker}, parse_fast_okx);
+	add_parse("parse/okx_ticker/json", {kOkxTicker}, parse_okx_frame_json);
+	add_parse("parse/okx_books10/fast", {books}, parse_fast_okx);
+	add_parse("parse/okx_books10/json", {books}, parse_okx_frame_json);
+
+	const char *journal = std::getenv("STRATEGIA_BENCH_JOURNAL");
+	if (!journal) return;
+	std::vector<std::string> binance, okx;
+	JournalReader reader(journal);
+	JournalReader::Frame f;
+	while (reader.next(f) && binance.size() + okx.size() < 200000) {
+		if (f.source == JournalSource::Binance) binance.emplace_back(f.payload);
+		else if (f.source == JournalSource::Okx) okx.emplace_back(f.payload);
+	}
+	if (!binance.empty()) add_parse("parse/recorded_binance", std::move(binance), parse_binance_frame);
+	if (!okx.empty()) add_parse("parse/recorded_okx", std::move(okx), parse_okx_frame);
+}
+
+void register_parse_checks() {
+	add_check("parse/parity/samples", [] {
+		const std::vector<std::string> binance = {kBinanceTicker, binance_depth(1), binance_depth(20),
+			kBinanceDepthOneSided, kBinanceOtherEvent};
+		const std::vector<std::string> okx = {kOkxTicker, okx_books(1), okx_books(10), kOkxSnapshot, kOkxAck};
+		const bool b = check_parity("binance samples", binance, parse_binance_frame_fast, parse_binance_frame_json, true);
+		const bool o = check_parity("okx samples", okx, parse_okx_frame_fast, parse_okx_frame_json, true);
+		return b && o;
+	});
+	add_check("book/okx_checksum", check_okx_book);
+	add_check("book/binance_sync", check_binance_book);
+
+	const char *journal = std::getenv("STRATEGIA_BENCH_JOURNAL");
+	if (!journal) return;
+	const std::string dir = journal;
+	add_check("parse/parity/recorded", [dir] {
+		std::vector<std::string> binance, okx;
+		JournalReader reader(dir);
+		JournalReader::Frame f;
+		while (reader.next(f)) {
+			if (f.source == JournalSource::Binance) binance.emplace_back(f.payload);
+			else if (f.source == JournalSource::Okx) okx.emplace_back(f.payload);
+		}
+		const bool b = check_parity("recorded binance", binance, parse_binance_frame_fast, parse_binance_frame_json, false);
+		const bool o = check_parity("recorded okx", okx, parse_okx_frame_fast, parse_okx_frame_json, false);
+		return b && o;
+	});
+}
+
+}
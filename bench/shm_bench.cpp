@@ -0,0 +1,87 @@
+// Shared-memory top of book: what a shard worker pays per update to mirror
+// it for other processes, and what a reader in another process pays to copy
+// a slot or drain the update ring. Publishing is two seqlock stores and a
+// wall-clock read for publish_ns; neither side allocates.
+#include "bench.hpp"
+#include "shm/top_of_book_publisher.hpp"
+#include "shm/top_of_book_reader.hpp"
+#include <memory>
+#include <string>
+#include <unistd.h>
+
+namespace strategia::bench {
+
+namespace {
+
+constexpr std::uint32_t kInstruments = 1000;
+constexpr std::uint64_t kBatch = 1024;
+
+struct Segment {
+	std::string name = "/strategia_bench_" + std::to_string(::getpid());
+	std::unique_ptr<TopOfBookPublisher> publisher;
+	std::unique_ptr<TopOfBookReader> reader;
+
+	Segment() {
+		InstrumentRegistry registry;
+		for (std::uint32_t i = 0; i < kInstruments; ++i) registry.intern("binance", "SYM" + std::to_string(i));
+		publisher = std::make_unique<TopOfBookPublisher>(name, registry, 1, 65536);
+		reader = std::make_unique<TopOfBookReader>(name);
+	}
+	~Segment() {
+		reader.reset();
+		publisher.reset();
+	}
+
+	void publish(std::uint64_t k) {
+		const auto p = static_cast<std::int64_t>(6430000000000 + k % 100);
+		publisher->publish(0, static_cast<InstrumentId>(k % kInstruments), shm::UpdateKind::Quote,
+			shm::Quote{kNullFixed, p, 100000000, p + 1, 200000000, static_cast<std::int64_t>(k), 0});
+	}
+};
+
+}
+
+void register_shm_benchmarks() {
+	add("shm/publish", [] {
+		auto seg = std::make_shared<Segment>();
+		auto next = std::make_shared<std::uint64_t>(0);
+		Case c;
+		c.run = [seg, next](std::uint64_t n) {
+			for (std::uint64_t k = 0; k < n; ++k) seg->publish((*next)++);
+		};
+		return c;
+	});
+
+	add("shm/read", [] {
+		auto seg = std::make_shared<Segment>();
+		for (std::uint64_t k = 0; k < kInstruments; ++k) seg->publish(k);
+		Case c;
+		c.run = [seg](std::uint64_t n) {
+			shm::Quote q;
+			for (std::uint64_t k = 0; k < n; ++k) {
+				do_not_optimize(seg->reader->read(static_cast<std::uint32_t>(k % kInstruments), q));
+				do_not_optimize(q);
+			}
+		};
+		return c;
+	});
+
+	// Publish a batch, then drain it as a polling reader would
+	add("shm/publish_poll", [] {
+		auto seg = std::make_shared<Segment>();
+		auto next = std::make_shared<std::uint64_t>(0);
+		Case c;
+		c.items_per_op = static_cast<double>(kBatch);
+		c.run = [seg, next](std::uint64_t n) {
+			std::int64_t sum = 0;
+			for (std::uint64_t k = 0; k < n; ++k) {
+				for (std::uint64_t i = 0; i < kBatch; ++i) seg->publish((*next)++);
+				seg->reader->poll([&sum](const shm::Update &u) { sum += u.bid_price; });
+			}
+			do_not_optimize(sum);
+		};
+		return c;
+	});
+}
+
+}
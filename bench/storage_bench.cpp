@@ -0,0 +1,111 @@
+// Storage: rows/sec of write_batch with a minute's worth of rows per batch.
+// PostgresWriter runs only when built in and STRATEGIA_BENCH_POSTGRES_DSN is set.
+#include "bench.hpp"
+#include "storage/csv_writer.hpp"
+#include "storage/columnar_writer.hpp"
+#ifdef STRATEGIA_ENABLE_POSTGRES
+#include "storage/postgres_writer.hpp"
+#endif
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace strategia::bench {
+
+namespace {
+
+constexpr int kRowsPerBatch = 500;
+
+std::vector<MinuteSnapshot> make_rows() {
+	std::vector<MinuteSnapshot> rows(kRowsPerBatch);
+	for (int i = 0; i < kRowsPerBatch; ++i) {
+		auto &r = rows[static_cast<std::size_t>(i)];
+		r.exchange = i % 2 ? "okx" : "binance";
+		r.symbol = "SYM" + std::to_string(i);
+		// Fixed point at the default scale of 8 decimals: 0.00012345 * (i + 1),
+		// 64123.1 + i, 0.731, 64123.2 + i, 1.25 and 64123.15
+		r.last_price = 12345 * (i + 1);
+		r.best_bid_price = std::int64_t{641231 + 10 * i} * 10000000;
+		r.best_bid_amount = 73100000;
+		r.best_ask_price = std::int64_t{641232 + 10 * i} * 10000000;
+		r.best_ask_amount = 125000000;
+		r.open = r.high = r.low = r.close = 6412315000000;
+		r.tick_count = 600;
+		r.twap_mid = 64123.15;
+		r.spread_min = r.spread_max = 10000000;
+		r.spread_mean = 0.1;
+	}
+	return rows;
+}
+
+// Removes the scratch directory after the writer inside it is gone
+struct ScratchDir {
+	fs::path path;
+	explicit ScratchDir(const std::string &name) : path(fs::temp_directory_path() / name) { fs::remove_all(path); }
+	~ScratchDir() { fs::remove_all(path); }
+};
+
+struct Sink {
+	std::unique_ptr<ScratchDir> dir;
+	std::unique_ptr<StorageWriter> writer;
+	std::vector<MinuteSnapshot> rows = make_rows();
+	std::int64_t minute = 0;
+
+	void write(std::uint64_t n) {
+		for (std::uint64_t k = 0; k < n; ++k) {
+			minute += 60;
+			for (auto &r : rows) r.minute_unix = minute;
+			writer->write_batch(rows);
+		}
+	}
+};
+
+void add_sink(const std::string &name, std::function<std::shared_ptr<Sink>()> make) {
+	add(name, [make] {
+		std::shared_ptr<Sink> sink = make();
+		sink->writer->ensure_schema();
+		Case c;
+		c.items_per_op = kRowsPerBatch;
+		c.run = [sink](std::uint64_t n) { sink->write(n); };
+		return c;
+	});
+}
+
+}
+
+void register_storage_benchmarks() {
+	for (bool fsync : {false, true}) {
+		add_sink(std::string("storage/csv/batch=500") + (fsync ? "/fsync" : ""), [fsync] {
+			auto sink = std::make_shared<Sink>();
+			sink->dir = std::make_unique<ScratchDir>("strategia_bench_csv");
+			sink->writer = std::make_unique<CsvWriter>(sink->dir->path.string(), fsync ? FsyncPolicy::EveryBatch : FsyncPolicy::Never);
+			return sink;
+		});
+	}
+	add_sink("storage/columnar/batch=500", [] {
+		auto sink = std::make_shared<Sink>();
+		sink->dir = std::make_unique<ScratchDir>("strategia_bench_columnar");
+		sink->writer = std::make_unique<ColumnarWriter>(sink->dir->path.string());
+		return sink;
+	});
+#ifdef STRATEGIA_ENABLE_POSTGRES
+	if (const char *dsn = std::getenv("STRATEGIA_BENCH_POSTGRES_DSN")) {
+		for (bool copy : {true, false}) {
+			add_sink(std::string("storage/postgres/batch=500/") + (copy ? "copy" : "insert"), [dsn = std::string(dsn), copy] {
+				auto sink = std::make_shared<Sink>();
+				PostgresOptions opts;
+				opts.use_copy = copy;
+				sink->writer = std::make_unique<PostgresWriter>(dsn, opts);
+				// Minutes far before any real data, so the benchmark never overwrites live rows
+				sink->minute = -(std::int64_t{1} << 40) + (copy ? 0 : std::int64_t{1} << 38);
+				return sink;
+			});
+		}
+	}
+#endif
+}
+
+}
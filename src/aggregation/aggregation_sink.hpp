@@ -0,0 +1,18 @@
+#pragma once
+
+#include "sharded_state.hpp"
+
+namespace strategia {
+
+// Feed client sink delivering straight into the aggregation state; the
+// service and the replay tool instantiate their exchange clients with it.
+// Anything derived from the events (the consolidated book) runs on the shard
+// workers, never on the feed thread.
+struct AggregationSink {
+	ShardedState *shards = nullptr;
+
+	void on_ticker(const TickerData &t) const { shards->on_ticker(t); }
+	void on_orderbook(const OrderBookData &o) const { shards->on_orderbook(o); }
+};
+
+}
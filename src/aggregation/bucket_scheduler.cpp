@@ -0,0 +1,98 @@
+#include "bucket_scheduler.hpp"
+#include "metrics/metrics_registry.hpp"
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace strategia {
+
+namespace {
+
+[[noreturn]] void throw_errno(const std::string &what) {
+	throw std::system_error(errno, std::generic_category(), what);
+}
+
+}
+
+BucketScheduler::BucketScheduler(std::int64_t width_ms)
+	: width_ms_(width_ms)
+	, lag_(MetricsRegistry::global().histogram("strategia_bucket_close_lag_seconds",
+		"Delay between a bucket's end and the flusher waking to close it"))
+	, missed_(MetricsRegistry::global().counter("strategia_bucket_missed_total",
+		"Buckets merged into the next one because the close woke too late")) {
+	if (width_ms < kMinWidthMs || width_ms > kMaxWidthMs) {
+		throw std::invalid_argument("bucket width " + duration_label(width_ms) + " outside 100ms..1h");
+	}
+	timer_fd_ = ::timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC);
+	if (timer_fd_ < 0) throw_errno("timerfd_create");
+	stop_fd_ = ::eventfd(0, EFD_CLOEXEC);
+	if (stop_fd_ < 0) {
+		const int err = errno;
+		::close(timer_fd_);
+		throw std::system_error(err, std::generic_category(), "eventfd");
+	}
+	open_ = bucket_at(current_unix_millis(), width_ms_);
+}
+
+BucketScheduler::~BucketScheduler() {
+	::close(timer_fd_);
+	::close(stop_fd_);
+}
+
+void BucketScheduler::arm(std::int64_t deadline_ms) {
+	itimerspec spec{};
+	spec.it_value.tv_sec = static_cast<time_t>(deadline_ms / 1000);
+	spec.it_value.tv_nsec = static_cast<long>(deadline_ms % 1000) * 1000000;
+	// CANCEL_ON_SET: a clock step fails the read with ECANCELED instead of leaving a stale deadline
+	if (::timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &spec, nullptr) != 0) {
+		throw_errno("timerfd_settime");
+	}
+}
+
+std::optional<TimeBucket> BucketScheduler::wait_close() {
+	while (!stopped_.load()) {
+		arm(open_.end_ms());
+		pollfd fds[2] = {{timer_fd_, POLLIN, 0}, {stop_fd_, POLLIN, 0}};
+		if (::poll(fds, 2, -1) < 0) {
+			if (errno == EINTR) continue;
+			throw_errno("poll");
+		}
+		if (fds[1].revents) break;
+		std::uint64_t expirations = 0;
+		if (::read(timer_fd_, &expirations, sizeof(expirations)) < 0 && errno != ECANCELED && errno != EAGAIN) {
+			throw_errno("timerfd read");
+		}
+		const std::int64_t now_ns = current_unix_nanos();
+		const std::int64_t lag_ns = now_ns - open_.end_ms() * 1000000;
+		if (lag_ns < 0) continue; // the clock was set back: wait for the new end
+
+		lag_.observe_ns(lag_ns);
+		stats_.last_lag_ns = lag_ns;
+		if (lag_ns > stats_.max_lag_ns) stats_.max_lag_ns = lag_ns;
+		lag_sum_ns_ += lag_ns;
+		++stats_.closes;
+		stats_.mean_lag_ns = lag_sum_ns_ / static_cast<std::int64_t>(stats_.closes);
+
+		const TimeBucket closed = open_;
+		open_ = bucket_at(now_ns / 1000000, width_ms_);
+		if (const std::int64_t skipped = (open_.start_ms - closed.end_ms()) / width_ms_; skipped > 0) {
+			stats_.missed += static_cast<std::uint64_t>(skipped);
+			missed_.inc(static_cast<std::uint64_t>(skipped));
+		}
+		return closed;
+	}
+	return std::nullopt;
+}
+
+void BucketScheduler::stop() {
+	stopped_.store(true);
+	const std::uint64_t one = 1;
+	[[maybe_unused]] const ssize_t n = ::write(stop_fd_, &one, sizeof(one));
+}
+
+}
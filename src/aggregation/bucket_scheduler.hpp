@@ -0,0 +1,64 @@
+#pragma once
+
+#include "time_utils.hpp"
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
+namespace strategia {
+
+class Counter;
+class DurationHistogram;
+
+// How late bucket closes woke up relative to the bucket end
+struct BucketCloseStats {
+	std::uint64_t closes = 0;
+	std::uint64_t missed = 0;  // buckets skipped because a wake came more than a bucket late
+	std::int64_t last_lag_ns = 0;
+	std::int64_t max_lag_ns = 0;
+	std::int64_t mean_lag_ns = 0;
+};
+
+// Wakes the flusher at wall-clock bucket boundaries. Waits on a timerfd armed
+// with the absolute end of the open bucket (CLOCK_REALTIME), so closes do not
+// drift or poll, and a clock step re-arms the timer instead of oversleeping.
+// Lag is recorded as strategia_bucket_close_lag_seconds.
+class BucketScheduler {
+public:
+	static constexpr std::int64_t kMinWidthMs = 100;
+	static constexpr std::int64_t kMaxWidthMs = 3600000;
+
+	// Throws std::invalid_argument outside [kMinWidthMs, kMaxWidthMs] and
+	// std::system_error if the timer cannot be created
+	explicit BucketScheduler(std::int64_t width_ms);
+	~BucketScheduler();
+	BucketScheduler(const BucketScheduler&) = delete;
+	BucketScheduler &operator=(const BucketScheduler&) = delete;
+
+	std::int64_t width_ms() const { return width_ms_; }
+
+	// Blocks until the open bucket ends and returns it; std::nullopt once
+	// stop() was called. If the wake is more than a bucket late, the buckets
+	// in between are skipped and their events land in the returned one.
+	// Single caller.
+	std::optional<TimeBucket> wait_close();
+	// Wakes wait_close(); thread-safe
+	void stop();
+
+	const BucketCloseStats &stats() const { return stats_; } // wait_close() thread only
+
+private:
+	void arm(std::int64_t deadline_ms);
+
+	std::int64_t width_ms_;
+	TimeBucket open_;
+	int timer_fd_ = -1;
+	int stop_fd_ = -1;
+	std::atomic<bool> stopped_{false};
+	BucketCloseStats stats_;
+	std::int64_t lag_sum_ns_ = 0;
+	DurationHistogram &lag_;
+	Counter &missed_;
+};
+
+}
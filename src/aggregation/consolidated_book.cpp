@@ -0,0 +1,244 @@
+#include "consolidated_book.hpp"
+#include "metrics/metrics_registry.hpp"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace strategia {
+
+namespace {
+
+// "a:1,b:2" -> {{"a","1"},{"b","2"}}; split at the last ':' or the first '='
+std::vector<std::pair<std::string, std::string>> split_pairs(const std::string &list, char sep, const char *what) {
+	std::vector<std::pair<std::string, std::string>> out;
+	std::stringstream ss(list);
+	std::string item;
+	while (std::getline(ss, item, ',')) {
+		if (item.empty()) continue;
+		const std::size_t at = sep == ':' ? item.rfind(sep) : item.find(sep);
+		if (at == std::string::npos || at == 0 || at + 1 == item.size()) {
+			throw std::invalid_argument(std::string("malformed ") + what + " entry: " + item);
+		}
+		out.emplace_back(item.substr(0, at), item.substr(at + 1));
+	}
+	return out;
+}
+
+}
+
+ConsolidatedBook::ConsolidatedBook(const std::string &fees_bps, const std::string &symbol_map, std::int64_t max_quote_age_ms)
+	: max_quote_age_ms_(max_quote_age_ms)
+	, windows_(MetricsRegistry::global().counter("strategia_arbitrage_windows_total",
+		"Times the consolidated book crossed between venues after fees")) {
+	for (const auto &[exchange, bps] : split_pairs(fees_bps, ':', "fee")) {
+		std::size_t used = 0;
+		double v = 0.0;
+		try {
+			v = std::stod(bps, &used);
+		} catch (const std::exception &) {
+			used = 0;
+		}
+		if (used != bps.size() || v < 0.0 || v >= 10000.0) throw std::invalid_argument("malformed fee entry: " + exchange + ":" + bps);
+		fees_bps_[exchange] = v;
+	}
+	for (const auto &[from, to] : split_pairs(symbol_map, '=', "symbol map")) symbol_map_[from] = to;
+}
+
+std::string ConsolidatedBook::canonical_symbol(const std::string &symbol) {
+	std::string out;
+	out.reserve(symbol.size());
+	for (const char c : symbol) {
+		if (c == '-' || c == '_' || c == '/') continue;
+		out.push_back(static_cast<char>(std::toupper(static_cast<unsigned char>(c))));
+	}
+	return out;
+}
+
+std::size_t ConsolidatedBook::venue_index(const std::string &exchange) {
+	const auto it = std::find(venues_.begin(), venues_.end(), exchange);
+	if (it != venues_.end()) return static_cast<std::size_t>(it - venues_.begin());
+	if (venues_.size() == kMaxVenues) throw std::invalid_argument("ConsolidatedBook: too many venues");
+	venues_.push_back(exchange);
+	const auto fee = fees_bps_.find(exchange);
+	fee_rate_.push_back(fee != fees_bps_.end() ? fee->second / 10000.0 : 0.0);
+	return venues_.size() - 1;
+}
+
+std::string ConsolidatedBook::group_name(const std::string &exchange, const std::string &symbol) const {
+	const auto mapped = symbol_map_.find(exchange + ":" + symbol);
+	return mapped != symbol_map_.end() ? mapped->second : canonical_symbol(symbol);
+}
+
+void ConsolidatedBook::add_instrument(InstrumentId id, const std::string &exchange, const std::string &symbol, FixedScale scale) {
+	const std::string name = group_name(exchange, symbol);
+	const std::size_t venue = venue_index(exchange);
+
+	auto [it, inserted] = group_index_.emplace(name, static_cast<std::uint32_t>(groups_.size()));
+	if (inserted) {
+		groups_.push_back(std::make_unique<Group>());
+		groups_.back()->symbol = name;
+	}
+	Group &g = *groups_[it->second];
+	g.venue_mask |= 1u << venue;
+	g.consolidated = (g.venue_mask & (g.venue_mask - 1)) != 0;
+
+	if (routes_.size() <= id) routes_.resize(id + 1);
+	routes_[id] = Route{it->second, static_cast<std::uint32_t>(venue), true,
+		static_cast<double>(pow10_fixed(scale.price)), static_cast<double>(pow10_fixed(scale.qty))};
+}
+
+std::uint32_t ConsolidatedBook::group_of(InstrumentId id) const {
+	if (id >= routes_.size() || !routes_[id].known) return kNoGroup;
+	const std::uint32_t group = routes_[id].group;
+	return groups_[group]->consolidated ? group : kNoGroup;
+}
+
+void ConsolidatedBook::on_quote(const MarketEvent &e) {
+	if (e.instrument >= routes_.size()) return;
+	const Route route = routes_[e.instrument];
+	if (!route.known) return;
+	Group &g = *groups_[route.group];
+	if (!g.consolidated) return;
+
+	// REST snapshots may come without an exchange timestamp
+	const std::int64_t now_ms = e.ts_ms > 0 ? e.ts_ms : current_unix_millis();
+	VenueQuote &q = g.quotes[route.venue];
+	q.bid = e.has_bid ? static_cast<double>(e.bid_price) / route.price_div : 0.0;
+	q.bid_amount = e.has_bid ? static_cast<double>(e.bid_amount) / route.qty_div : 0.0;
+	q.ask = e.has_ask ? static_cast<double>(e.ask_price) / route.price_div : 0.0;
+	q.ask_amount = e.has_ask ? static_cast<double>(e.ask_amount) / route.qty_div : 0.0;
+	q.ts_ms = now_ms;
+	rank(g, now_ms);
+	g.published.store(g.top);
+}
+
+void ConsolidatedBook::rank(Group &g, std::int64_t now_ms) {
+	ConsolidatedQuote top;
+	top.ts_ms = now_ms;
+	for (std::size_t v = 0; v < venues_.size(); ++v) {
+		const VenueQuote &q = g.quotes[v];
+		if (q.ts_ms == 0 || now_ms - q.ts_ms > max_quote_age_ms_) continue;
+		if (q.bid > 0.0) {
+			const double bid = q.bid * (1.0 - fee_rate_[v]);
+			if (top.bid_venue < 0 || bid > top.bid) {
+				top.bid = bid;
+				top.bid_amount = q.bid_amount;
+				top.bid_venue = static_cast<int>(v);
+			}
+		}
+		if (q.ask > 0.0) {
+			const double ask = q.ask * (1.0 + fee_rate_[v]);
+			if (top.ask_venue < 0 || ask < top.ask) {
+				top.ask = ask;
+				top.ask_amount = q.ask_amount;
+				top.ask_venue = static_cast<int>(v);
+			}
+		}
+	}
+	g.top = top;
+	++g.updates;
+
+	bool crossed = false;
+	if (top.bid_venue >= 0 && top.ask_venue >= 0) {
+		const double spread = top.ask - top.bid;
+		if (g.spread_count++ == 0) {
+			g.spread_min = g.spread_max = spread;
+		} else {
+			g.spread_min = std::min(g.spread_min, spread);
+			g.spread_max = std::max(g.spread_max, spread);
+		}
+		g.spread_sum += spread;
+		// One venue cannot cross itself; the check guards against a stale pair
+		crossed = spread < 0.0 && top.bid_venue != top.ask_venue;
+		if (crossed) g.max_edge_bps = std::max(g.max_edge_bps, -spread / ((top.ask + top.bid) / 2.0) * 10000.0);
+	}
+	if (crossed && !g.crossed) {
+		++g.windows;
+		windows_.inc();
+		g.crossed_since_ms = now_ms;
+	} else if (!crossed && g.crossed) {
+		// Venue clocks differ: never let a window run backwards
+		g.crossed_ms += std::max<std::int64_t>(now_ms - g.crossed_since_ms, 0);
+	}
+	g.crossed = crossed;
+}
+
+std::optional<ConsolidatedQuote> ConsolidatedBook::top(const std::string &symbol) const {
+	const auto it = group_index_.find(symbol);
+	if (it == group_index_.end()) return std::nullopt;
+	const Group &g = *groups_[it->second];
+	if (!g.consolidated) return std::nullopt;
+	ConsolidatedQuote out;
+	g.published.load(out);
+	return out;
+}
+
+void ConsolidatedBook::close_group(std::uint32_t group, const TimeBucket &bucket) {
+	Group &g = *groups_[group];
+	const std::int64_t end_ms = bucket.end_ms();
+	if (g.crossed) {
+		// A window still open is split at the boundary
+		g.crossed_ms += std::max<std::int64_t>(end_ms - g.crossed_since_ms, 0);
+		g.crossed_since_ms = std::max(g.crossed_since_ms, end_ms);
+	}
+	ConsolidatedStats &row = g.closed;
+	row.bucket = bucket;
+	row.symbol = g.symbol;
+	row.top = g.top;
+	row.updates = g.updates;
+	row.spread_count = g.spread_count;
+	row.spread_min = g.spread_min;
+	row.spread_max = g.spread_max;
+	row.spread_mean = g.spread_count > 0 ? g.spread_sum / static_cast<double>(g.spread_count) : 0.0;
+	row.windows = g.windows;
+	row.crossed_ms = g.crossed_ms;
+	row.max_edge_bps = g.max_edge_bps;
+	g.has_closed = true;
+
+	g.updates = 0;
+	g.spread_count = 0;
+	g.spread_sum = 0.0;
+	g.windows = 0;
+	g.crossed_ms = 0;
+	g.max_edge_bps = 0.0;
+}
+
+std::vector<ConsolidatedStats> ConsolidatedBook::closed() const {
+	std::vector<ConsolidatedStats> out;
+	for (const auto &gp : groups_) {
+		if (gp->has_closed) out.push_back(gp->closed);
+	}
+	return out;
+}
+
+void append_consolidated_csv(const std::string &path, const std::vector<std::string> &venues,
+	const std::vector<ConsolidatedStats> &rows) {
+	if (rows.empty()) return;
+	std::error_code ec;
+	const std::filesystem::path parent = std::filesystem::path(path).parent_path();
+	if (!parent.empty()) std::filesystem::create_directories(parent, ec);
+	const bool fresh = !std::filesystem::exists(path, ec) || std::filesystem::file_size(path, ec) == 0;
+	std::ofstream out(path, std::ios::app);
+	if (!out) throw std::runtime_error("cannot open " + path);
+	if (fresh) {
+		out << "bucket_start_ms,bucket_width_ms,symbol,bid,bid_venue,ask,ask_venue,updates,"
+			"cross_spread_min,cross_spread_max,cross_spread_mean,arb_windows,crossed_ms,max_edge_bps\n";
+	}
+	out.precision(10);
+	auto venue = [&](int v) { return v >= 0 ? venues[static_cast<std::size_t>(v)] : std::string(); };
+	for (const auto &r : rows) {
+		out << r.bucket.start_ms << ',' << r.bucket.width_ms << ',' << r.symbol << ',';
+		if (r.top.bid_venue >= 0) out << r.top.bid;
+		out << ',' << venue(r.top.bid_venue) << ',';
+		if (r.top.ask_venue >= 0) out << r.top.ask;
+		out << ',' << venue(r.top.ask_venue) << ',' << r.updates << ',';
+		if (r.spread_count > 0) out << r.spread_min << ',' << r.spread_max << ',' << r.spread_mean;
+		else out << ",,";
+		out << ',' << r.windows << ',' << r.crossed_ms << ',' << r.max_edge_bps << '\n';
+	}
+}
+
+}
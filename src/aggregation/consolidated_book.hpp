@@ -0,0 +1,158 @@
+#pragma once
+
+#include "cache_line.hpp"
+#include "market_event.hpp"
+#include "seqlock.hpp"
+#include "time_utils.hpp"
+#include "instrument_registry.hpp"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace strategia {
+
+class Counter;
+
+// Best bid/offer across venues after taker fees: bid is what selling there
+// nets, ask what buying there costs. Venue is an index into venues(), -1 if
+// no venue quotes that side. Fee-adjusted prices are not exact in any scale,
+// so venues are compared in double.
+struct ConsolidatedQuote {
+	double bid = 0.0;
+	double bid_amount = 0.0;
+	int bid_venue = -1;
+	double ask = 0.0;
+	double ask_amount = 0.0;
+	int ask_venue = -1;
+	std::int64_t ts_ms = 0;
+};
+
+// One symbol over one bucket. Cross spread is ask - bid of the consolidated
+// quote, sampled on every update with both sides; it is negative while the
+// book is crossed between venues, i.e. buying on one and selling on the other
+// pays after fees. Such a stretch is an arbitrage window.
+struct ConsolidatedStats {
+	TimeBucket bucket;
+	std::string symbol;
+	ConsolidatedQuote top; // at close
+	std::int64_t updates = 0;
+	std::int64_t spread_count = 0;
+	double spread_min = 0.0;
+	double spread_max = 0.0;
+	double spread_mean = 0.0;
+	std::int64_t windows = 0;     // arbitrage windows opened in the bucket
+	std::int64_t crossed_ms = 0;  // time spent crossed
+	double max_edge_bps = 0.0;    // widest cross, relative to the consolidated mid
+};
+
+// Consolidated top of book of the symbols listed on more than one venue.
+// Venue symbols map to one name by dropping separators and upper-casing
+// (BTCUSDT and BTC-USDT are both BTCUSDT) unless overridden. A symbol's
+// venues are applied by one thread, the shard worker that owns them all
+// (see ShardedState::set_consolidated_book), which re-ranks just that symbol
+// on every quote without locking; other threads read top() through a seqlock.
+class ConsolidatedBook {
+public:
+	static constexpr std::size_t kMaxVenues = 8;
+	static constexpr std::uint32_t kNoGroup = ~std::uint32_t{0};
+
+	// fees_bps: "binance:10,okx:8", taker fee per venue in basis points (0 if
+	// unlisted). symbol_map: "okx:BTC-USDC=BTCUSDT,...", consolidated names
+	// overriding the default mapping. A quote older than max_quote_age_ms
+	// against the update being applied drops out of the ranking.
+	// Throws std::invalid_argument on malformed lists.
+	ConsolidatedBook(const std::string &fees_bps, const std::string &symbol_map, std::int64_t max_quote_age_ms = 5000);
+	ConsolidatedBook(const ConsolidatedBook&) = delete;
+	ConsolidatedBook &operator=(const ConsolidatedBook&) = delete;
+
+	// Register everything before the first on_quote(); not synchronized.
+	// scale is the fixed-point scale of the instrument's book levels.
+	void add_instrument(InstrumentId id, const std::string &exchange, const std::string &symbol, FixedScale scale = {});
+	// Consolidated name a venue symbol maps to
+	std::string group_name(const std::string &exchange, const std::string &symbol) const;
+	// Index of the instrument's symbol, kNoGroup unless it trades on several venues
+	std::uint32_t group_of(InstrumentId id) const;
+
+	// Quote events, from the thread that owns the instrument's group; ignores
+	// instruments whose symbol trades on one venue only
+	void on_quote(const MarketEvent &e);
+
+	// Latest consolidated quote of a symbol, std::nullopt if it is not consolidated; any thread
+	std::optional<ConsolidatedQuote> top(const std::string &symbol) const;
+	const std::vector<std::string> &venues() const { return venues_; }
+
+	// Owner thread: closes the group's statistics for the bucket and restarts
+	// them at bucket.end_ms()
+	void close_group(std::uint32_t group, const TimeBucket &bucket);
+	// One row per consolidated symbol from the last close_group() calls; read
+	// once the owners are done, i.e. after ShardedState::snapshot_and_rotate()
+	std::vector<ConsolidatedStats> closed() const;
+
+	// "BTC-USDT" -> "BTCUSDT"
+	static std::string canonical_symbol(const std::string &symbol);
+
+private:
+	struct VenueQuote {
+		double bid = 0.0;
+		double bid_amount = 0.0;
+		double ask = 0.0;
+		double ask_amount = 0.0;
+		std::int64_t ts_ms = 0; // 0: no quote yet
+	};
+
+	// Written by its owner thread only; a line of its own so owners never share one
+	struct alignas(kCacheLineSize) Group {
+		std::string symbol;
+		std::uint32_t venue_mask = 0; // venues listing it
+		bool consolidated = false;    // listed on more than one
+		std::array<VenueQuote, kMaxVenues> quotes{};
+		ConsolidatedQuote top;
+		Seqlock<ConsolidatedQuote> published; // top, for top()
+		ConsolidatedStats closed;             // last close_group() row
+		bool has_closed = false;
+		// bucket statistics
+		std::int64_t updates = 0;
+		std::int64_t spread_count = 0;
+		double spread_min = 0.0;
+		double spread_max = 0.0;
+		double spread_sum = 0.0;
+		std::int64_t windows = 0;
+		std::int64_t crossed_ms = 0;
+		double max_edge_bps = 0.0;
+		bool crossed = false;
+		std::int64_t crossed_since_ms = 0;
+	};
+
+	struct Route {
+		std::uint32_t group = 0;
+		std::uint32_t venue = 0;
+		bool known = false;
+		double price_div = 1.0; // 10^scale, fixed point -> double
+		double qty_div = 1.0;
+	};
+
+	std::size_t venue_index(const std::string &exchange);
+	void rank(Group &g, std::int64_t now_ms);
+
+	std::vector<std::string> venues_;
+	std::vector<double> fee_rate_; // per venue
+	std::unordered_map<std::string, double> fees_bps_; // exchange -> bps, as configured
+	std::unordered_map<std::string, std::string> symbol_map_; // "exchange:symbol" -> name
+	std::int64_t max_quote_age_ms_;
+	std::vector<std::unique_ptr<Group>> groups_;
+	std::unordered_map<std::string, std::uint32_t> group_index_;
+	std::vector<Route> routes_; // indexed by InstrumentId
+	Counter &windows_;
+};
+
+// Appends one line per symbol to a CSV file (header on first write):
+// bucket_start_ms,bucket_width_ms,symbol,bid,bid_venue,ask,ask_venue,updates,
+// cross_spread_min,cross_spread_max,cross_spread_mean,arb_windows,crossed_ms,max_edge_bps
+void append_consolidated_csv(const std::string &path, const std::vector<std::string> &venues,
+	const std::vector<ConsolidatedStats> &rows);
+
+}
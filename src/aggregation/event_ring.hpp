@@ -0,0 +1,93 @@
+#pragma once
+
+#include "cache_line.hpp"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+namespace strategia {
+
+// Bounded lock-free queue of fixed-size records (Vyukov's array queue). Each
+// cell carries a sequence number telling producers and consumers whose turn
+// it is, so a push or pop is one CAS on the shared position plus plain copies.
+// Safe for any number of producers and consumers; the aggregator runs one
+// consumer per ring and lets producers pop only to evict the oldest record.
+template<typename T>
+class EventRing {
+	static_assert(std::is_trivially_copyable_v<T>, "EventRing carries trivially copyable records");
+
+public:
+	explicit EventRing(std::size_t capacity) {
+		std::size_t cap = 2;
+		while (cap < capacity) cap <<= 1;
+		mask_ = cap - 1;
+		cells_ = std::make_unique<Cell[]>(cap);
+		for (std::size_t i = 0; i < cap; ++i) cells_[i].seq.store(i, std::memory_order_relaxed);
+	}
+
+	EventRing(const EventRing&) = delete;
+	EventRing &operator=(const EventRing&) = delete;
+
+	bool try_push(const T &value) {
+		std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+		for (;;) {
+			Cell &cell = cells_[pos & mask_];
+			const std::size_t seq = cell.seq.load(std::memory_order_acquire);
+			const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+			if (diff == 0) {
+				if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					cell.value = value;
+					cell.seq.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (diff < 0) {
+				return false; // full
+			} else {
+				pos = enqueue_pos_.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	bool try_pop(T &out) {
+		std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+		for (;;) {
+			Cell &cell = cells_[pos & mask_];
+			const std::size_t seq = cell.seq.load(std::memory_order_acquire);
+			const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+			if (diff == 0) {
+				if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					out = cell.value;
+					cell.seq.store(pos + mask_ + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (diff < 0) {
+				return false; // empty
+			} else {
+				pos = dequeue_pos_.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// Approximate while producers or consumers are active
+	std::size_t size() const {
+		const std::size_t head = dequeue_pos_.load(std::memory_order_relaxed);
+		const std::size_t tail = enqueue_pos_.load(std::memory_order_relaxed);
+		return tail > head ? tail - head : 0;
+	}
+	std::size_t capacity() const { return mask_ + 1; }
+	std::size_t pushed() const { return enqueue_pos_.load(std::memory_order_relaxed); }
+
+private:
+	struct Cell {
+		std::atomic<std::size_t> seq{0};
+		T value{};
+	};
+
+	std::unique_ptr<Cell[]> cells_;
+	std::size_t mask_ = 0;
+	alignas(kCacheLineSize) std::atomic<std::size_t> enqueue_pos_{0};
+	alignas(kCacheLineSize) std::atomic<std::size_t> dequeue_pos_{0};
+};
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "exchanges/exchange_client.hpp"
+#include <cstdint>
+
+namespace strategia {
+
+// Fixed-size copy of a feed callback, handed from a receive thread to the
+// aggregation shard that owns the instrument.
+struct MarketEvent {
+	enum class Kind : std::uint8_t { Ticker, Quote };
+
+	Kind kind = Kind::Ticker;
+	bool has_bid = false;
+	bool has_ask = false;
+	InstrumentId instrument = kInvalidInstrument;
+	std::int64_t ts_ms = 0;
+	std::int64_t parsed_ns = 0; // 0: no latency sample
+	// Fixed point at the instrument's scale
+	std::int64_t price = 0; // Ticker
+	std::int64_t bid_price = 0;
+	std::int64_t bid_amount = 0;
+	std::int64_t ask_price = 0;
+	std::int64_t ask_amount = 0;
+
+	static MarketEvent ticker(const TickerData &t) {
+		MarketEvent e;
+		e.kind = Kind::Ticker;
+		e.instrument = t.instrument;
+		e.ts_ms = t.ts_ms;
+		e.parsed_ns = t.parsed_ns;
+		e.price = t.price;
+		return e;
+	}
+
+	static MarketEvent quote(const OrderBookData &o) {
+		MarketEvent e;
+		e.kind = Kind::Quote;
+		e.instrument = o.instrument;
+		e.ts_ms = o.ts_ms;
+		e.parsed_ns = o.parsed_ns;
+		if (!o.bids.empty()) {
+			e.has_bid = true;
+			e.bid_price = o.bids.front().price;
+			e.bid_amount = o.bids.front().amount;
+		}
+		if (!o.asks.empty()) {
+			e.has_ask = true;
+			e.ask_price = o.asks.front().price;
+			e.ask_amount = o.asks.front().amount;
+		}
+		return e;
+	}
+};
+
+}
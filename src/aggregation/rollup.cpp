@@ -0,0 +1,140 @@
+#include "rollup.hpp"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+namespace strategia {
+
+namespace {
+
+void keep_min(std::int64_t &acc, std::int64_t v) {
+	if (!is_null(v) && (is_null(acc) || v < acc)) acc = v;
+}
+
+void keep_max(std::int64_t &acc, std::int64_t v) {
+	if (!is_null(v) && (is_null(acc) || v > acc)) acc = v;
+}
+
+// Folds a later finer row of the same instrument into bar
+void merge(MinuteSnapshot &bar, const MinuteSnapshot &row) {
+	for (auto [acc, v] : { std::pair{&bar.last_price, &row.last_price}, std::pair{&bar.best_bid_price, &row.best_bid_price},
+			std::pair{&bar.best_bid_amount, &row.best_bid_amount}, std::pair{&bar.best_ask_price, &row.best_ask_price},
+			std::pair{&bar.best_ask_amount, &row.best_ask_amount} }) {
+		if (!is_null(*v)) *acc = *v;
+	}
+
+	if (!is_null(row.open)) {
+		if (is_null(bar.open)) bar.open = row.open;
+		keep_max(bar.high, row.high);
+		keep_min(bar.low, row.low);
+		bar.close = row.close;
+	}
+	bar.tick_count += row.tick_count;
+
+	if (!is_null(row.spread_mean)) {
+		keep_min(bar.spread_min, row.spread_min);
+		keep_max(bar.spread_max, row.spread_max);
+		if (is_null(bar.spread_mean) || bar.quote_count == 0) bar.spread_mean = row.spread_mean;
+		else if (row.quote_count > 0) {
+			bar.spread_mean = (bar.spread_mean * static_cast<double>(bar.quote_count) + row.spread_mean * static_cast<double>(row.quote_count))
+				/ static_cast<double>(bar.quote_count + row.quote_count);
+		}
+	}
+	bar.quote_count += row.quote_count;
+
+	if (!is_null(row.twap_mid)) {
+		if (is_null(bar.twap_mid) || (bar.twap_ms == 0 && row.twap_ms > 0)) bar.twap_mid = row.twap_mid;
+		else if (row.twap_ms > 0) {
+			bar.twap_mid = (bar.twap_mid * static_cast<double>(bar.twap_ms) + row.twap_mid * static_cast<double>(row.twap_ms))
+				/ static_cast<double>(bar.twap_ms + row.twap_ms);
+		}
+		bar.twap_ms += row.twap_ms;
+	}
+}
+
+}
+
+RollupPipeline::RollupPipeline(std::int64_t base_width_ms, std::vector<std::int64_t> widths_ms) {
+	std::int64_t finer = base_width_ms;
+	for (const std::int64_t w : widths_ms) {
+		if (w <= base_width_ms) continue;
+		if (w <= finer || w % finer != 0) {
+			throw std::invalid_argument("rollup " + duration_label(w) + " is not a multiple of " + duration_label(finer));
+		}
+		Level level;
+		level.width_ms = w;
+		levels_.push_back(std::move(level));
+		finer = w;
+	}
+}
+
+std::size_t RollupPipeline::slot_of(Level &level, const MinuteSnapshot &row, std::size_t hint) {
+	// Rows arrive in the same order every bucket, so the position usually matches
+	if (hint < level.bars.size() && level.bars[hint].symbol == row.symbol && level.bars[hint].exchange == row.exchange) return hint;
+	const auto it = level.index.try_emplace(row.exchange + '\n' + row.symbol, level.bars.size()).first;
+	if (it->second == level.bars.size()) {
+		MinuteSnapshot bar;
+		bar.exchange = row.exchange;
+		bar.symbol = row.symbol;
+		bar.bucket_width_ms = 0;
+		level.bars.push_back(std::move(bar));
+	}
+	return it->second;
+}
+
+void RollupPipeline::add(const std::vector<MinuteSnapshot> &rows, std::vector<MinuteSnapshot> &out) {
+	if (rows.empty() || levels_.empty()) return;
+	add_to(0, rows, out);
+}
+
+void RollupPipeline::add_to(std::size_t i, const std::vector<MinuteSnapshot> &rows, std::vector<MinuteSnapshot> &out) {
+	const TimeBucket fine{ rows.front().bucket_start_ms, rows.front().bucket_width_ms };
+	const TimeBucket target = bucket_at(fine.start_ms, levels_[i].width_ms);
+	// A gap (missed closes, a restart) may have skipped this level's boundary
+	if (levels_[i].active && !(levels_[i].open == target)) close(i, out);
+
+	Level &level = levels_[i];
+	level.open = target;
+	level.active = true;
+	for (std::size_t k = 0; k < rows.size(); ++k) {
+		MinuteSnapshot &bar = level.bars[slot_of(level, rows[k], k)];
+		if (bar.bucket_width_ms == 0) bar = rows[k];
+		else merge(bar, rows[k]);
+	}
+	if (fine.end_ms() == target.end_ms()) close(i, out);
+}
+
+void RollupPipeline::close(std::size_t i, std::vector<MinuteSnapshot> &out) {
+	Level &level = levels_[i];
+	level.active = false;
+	std::vector<MinuteSnapshot> closed;
+	closed.reserve(level.bars.size());
+	for (auto &bar : level.bars) {
+		if (bar.bucket_width_ms == 0) continue;
+		bar.minute_unix = level.open.start_ms / 1000;
+		bar.bucket_start_ms = level.open.start_ms;
+		bar.bucket_width_ms = level.width_ms;
+		closed.push_back(bar);
+		bar.bucket_width_ms = 0;
+	}
+	out.insert(out.end(), closed.begin(), closed.end());
+	if (i + 1 < levels_.size() && !closed.empty()) add_to(i + 1, closed, out);
+}
+
+void RollupPipeline::flush(std::vector<MinuteSnapshot> &out) {
+	for (std::size_t i = 0; i < levels_.size(); ++i) {
+		if (levels_[i].active) close(i, out);
+	}
+}
+
+std::vector<std::int64_t> parse_rollup_widths(const std::string &list) {
+	std::vector<std::int64_t> out;
+	std::stringstream ss(list);
+	std::string item;
+	while (std::getline(ss, item, ',')) {
+		if (!item.empty()) out.push_back(parse_duration_ms(item));
+	}
+	return out;
+}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "time_utils.hpp"
+#include "storage/storage_writer.hpp"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace strategia {
+
+// Folds the rows of each closed bucket into coarser timeframes as they go,
+// e.g. 1s -> 1m -> 5m -> 1h -> 1d: every level merges the rows the level
+// below emits and emits its own when its bucket ends. Bars merge exactly
+// (open/close from the first/last bar with ticks, high/low, tick and quote
+// counts, spread min/max, spread mean weighted by quotes, TWAP weighted by
+// time); last price and best bid/ask are those of the last bar. Coarse
+// buckets in progress are kept in memory only, so after a restart the first
+// coarse row of each level covers less than its width. Not thread-safe.
+class RollupPipeline {
+public:
+	// widths_ms ascending, each a multiple of the one before it (the first of
+	// base_width_ms); widths up to base_width_ms are skipped. Throws
+	// std::invalid_argument otherwise.
+	RollupPipeline(std::int64_t base_width_ms, std::vector<std::int64_t> widths_ms);
+
+	// Rows of one closed base bucket, all with the same bucket; appends the
+	// rows of every coarser bucket that closed with it, finer levels first
+	void add(const std::vector<MinuteSnapshot> &rows, std::vector<MinuteSnapshot> &out);
+	// Emits the coarser buckets still open, e.g. at the end of a replay
+	void flush(std::vector<MinuteSnapshot> &out);
+
+	bool empty() const { return levels_.empty(); }
+
+private:
+	struct Level {
+		std::int64_t width_ms = 0;
+		TimeBucket open;
+		bool active = false;
+		std::vector<MinuteSnapshot> bars; // in progress, one per instrument; bucket_width_ms 0 = no rows yet
+		std::unordered_map<std::string, std::size_t> index; // exchange '\n' symbol -> bars slot
+	};
+
+	// Merges rows (all of one finer bucket) into level i, cascading what closes
+	void add_to(std::size_t i, const std::vector<MinuteSnapshot> &rows, std::vector<MinuteSnapshot> &out);
+	void close(std::size_t i, std::vector<MinuteSnapshot> &out);
+	static std::size_t slot_of(Level &level, const MinuteSnapshot &row, std::size_t hint);
+
+	std::vector<Level> levels_;
+};
+
+// "1m,5m,1h" -> {60000, 300000, 3600000}; empty for an empty list
+std::vector<std::int64_t> parse_rollup_widths(const std::string &list);
+
+}
@@ -0,0 +1,324 @@
+#include "sharded_state.hpp"
+#include "consolidated_book.hpp"
+#include "shm/top_of_book_publisher.hpp"
+#include "time_utils.hpp"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace strategia {
+
+namespace {
+// Empty polls before an idle worker parks on its condition variable
+constexpr int kIdleSpins = 256;
+}
+
+ShardedState::ShardedState(std::size_t shards, std::size_t queue_capacity, OverflowPolicy overflow)
+	: overflow_(overflow) {
+	shards_.resize(std::max<std::size_t>(shards, 1));
+	for (auto &s : shards_) s = std::make_unique<Shard>(queue_capacity);
+}
+
+ShardedState::~ShardedState() { stop(); }
+
+InstrumentId ShardedState::register_instrument(const std::string &exchange, const std::string &symbol, FixedScale scale,
+	const std::string &affinity) {
+	if (running_) throw std::logic_error("ShardedState: register instruments before start()");
+	const InstrumentId id = registry_.intern(exchange, symbol, scale);
+	if (id < shard_of_.size()) return id;
+	auto index = static_cast<std::uint32_t>(id % shards_.size());
+	if (!affinity.empty()) index = affinity_shard_.emplace(affinity, index).first->second;
+	Shard &shard = *shards_[index];
+	shard_of_.push_back(index);
+	local_of_.push_back(static_cast<std::uint32_t>(shard.state.size()));
+	shard.state.emplace_back();
+	shard.ids.push_back(id);
+	return id;
+}
+
+void ShardedState::start() {
+	if (running_) return;
+	if (consolidated_) {
+		// Each group is ranked lock-free by the one worker holding all its venues
+		std::unordered_map<std::uint32_t, std::size_t> owner;
+		for (std::size_t i = 0; i < shards_.size(); ++i) {
+			Shard &shard = *shards_[i];
+			shard.groups.clear();
+			for (const InstrumentId id : shard.ids) {
+				const std::uint32_t group = consolidated_->group_of(id);
+				if (group == ConsolidatedBook::kNoGroup) continue;
+				const auto [it, first] = owner.emplace(group, i);
+				if (first) shard.groups.push_back(group);
+				else if (it->second != i) {
+					throw std::logic_error("ShardedState: " + registry_.get(id).exchange + ":" + registry_.get(id).symbol
+						+ " is on another shard than the other venues of its consolidated symbol");
+				}
+			}
+		}
+	}
+	running_ = true;
+	if (!published_) {
+		published_count_ = registry_.size();
+		published_ = std::make_unique<PublishedQuote[]>(published_count_);
+	}
+	if (latency_) {
+		latency_exchange_.resize(registry_.size());
+		for (InstrumentId id = 0; id < registry_.size(); ++id) latency_exchange_[id] = latency_->add_exchange(registry_.get(id).exchange);
+	}
+	for (std::size_t i = 0; i < shards_.size(); ++i) {
+		Shard &shard = *shards_[i];
+		if (overflow_ == OverflowPolicy::Conflate && !shard.conflation) {
+			shard.conflation = std::make_unique<ConflationSlot[]>(shard.state.size() * 2);
+		}
+		shard.stopping.store(false);
+		shard.worker = std::thread([this, i]{ run_shard(i); });
+	}
+}
+
+void ShardedState::stop() {
+	if (!running_) return;
+	for (auto &s : shards_) {
+		s->stopping.store(true);
+		wake(*s);
+	}
+	for (auto &s : shards_) {
+		if (s->worker.joinable()) s->worker.join();
+	}
+	running_ = false;
+}
+
+void ShardedState::wake(Shard &shard) {
+	{
+		std::lock_guard<std::mutex> lk(shard.mu);
+		shard.sleeping.store(false, std::memory_order_relaxed);
+	}
+	shard.cv.notify_one();
+}
+
+void ShardedState::post(const MarketEvent &e) {
+	if (e.instrument >= registry_.size()) return;
+	Shard &shard = *shards_[shard_of_[e.instrument]];
+	if (shard.conflation) {
+		// Once an instrument has a parked event, later ones join it so the
+		// worker never applies a parked event after a newer queued one.
+		ConflationSlot &slot = shard.conflation[local_of_[e.instrument] * 2 + (e.kind == MarketEvent::Kind::Quote)];
+		if (slot.event.version() != slot.applied.load(std::memory_order_acquire)) {
+			slot.event.store(e);
+			shard.conflated.fetch_add(1, std::memory_order_relaxed);
+			shard.conflation_writes.fetch_add(1, std::memory_order_release);
+			return;
+		}
+	}
+	if (!shard.ring.try_push(e)) overflow(shard, e);
+
+	// Pairs with the fence in run_shard: either the worker sees the event or we see it asleep
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (shard.sleeping.load(std::memory_order_relaxed)) wake(shard);
+}
+
+void ShardedState::overflow(Shard &shard, const MarketEvent &e) {
+	switch (overflow_) {
+	case OverflowPolicy::Block:
+		shard.blocked.fetch_add(1, std::memory_order_relaxed);
+		while (!shard.ring.try_push(e)) {
+			if (shard.sleeping.load(std::memory_order_relaxed)) wake(shard);
+			std::this_thread::yield();
+		}
+		break;
+	case OverflowPolicy::DropOldest: {
+		MarketEvent evicted;
+		while (!shard.ring.try_push(e)) {
+			if (shard.ring.try_pop(evicted)) shard.dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+		break;
+	}
+	case OverflowPolicy::Conflate: {
+		ConflationSlot &slot = shard.conflation[local_of_[e.instrument] * 2 + (e.kind == MarketEvent::Kind::Quote)];
+		slot.event.store(e);
+		shard.conflated.fetch_add(1, std::memory_order_relaxed);
+		shard.conflation_writes.fetch_add(1, std::memory_order_release);
+		break;
+	}
+	}
+}
+
+void ShardedState::apply(InMemoryState &s, const MarketEvent &e) {
+	if (e.kind == MarketEvent::Kind::Ticker) {
+		s.last_price = e.price;
+		s.bucket.on_price(e.price);
+		return;
+	}
+	if (e.has_bid) {
+		s.best_bid_price = e.bid_price;
+		s.best_bid_amount = e.bid_amount;
+	}
+	if (e.has_ask) {
+		s.best_ask_price = e.ask_price;
+		s.best_ask_amount = e.ask_amount;
+	}
+	if (e.has_bid && e.has_ask) s.bucket.on_quote(e.bid_price, e.ask_price, e.ts_ms);
+}
+
+void ShardedState::apply_event(Shard &shard, const MarketEvent &e) {
+	InMemoryState &s = shard.state[local_of_[e.instrument]];
+	apply(s, e);
+	published_[e.instrument].quote.store(InstrumentQuote{
+		s.last_price, s.best_bid_price, s.best_bid_amount, s.best_ask_price, s.best_ask_amount, e.ts_ms});
+	if (publisher_) {
+		const auto kind = e.kind == MarketEvent::Kind::Ticker ? shm::UpdateKind::Trade : shm::UpdateKind::Quote;
+		publisher_->publish(shard_of_[e.instrument], e.instrument, kind, shm::Quote{
+			s.last_price, s.best_bid_price, s.best_bid_amount, s.best_ask_price, s.best_ask_amount, e.ts_ms, 0});
+	}
+	if (consolidated_ && e.kind == MarketEvent::Kind::Quote) consolidated_->on_quote(e);
+	if (latency_ && e.parsed_ns != 0) {
+		const FeedChannel channel = e.kind == MarketEvent::Kind::Ticker ? FeedChannel::Ticker : FeedChannel::Book;
+		latency_->record(latency_exchange_[e.instrument], channel, LatencyStage::ParseToApply, current_unix_nanos() - e.parsed_ns);
+	}
+}
+
+std::size_t ShardedState::drain(Shard &shard) {
+	std::size_t applied = 0;
+	MarketEvent e;
+	while (shard.ring.try_pop(e)) {
+		apply_event(shard, e);
+		++applied;
+	}
+	// Parked events are newer than anything of theirs that was in the ring
+	const std::uint64_t writes = shard.conflation_writes.load(std::memory_order_acquire);
+	if (shard.conflation && writes != shard.seen_conflation_writes) {
+		shard.seen_conflation_writes = writes;
+		for (std::size_t i = 0; i < shard.state.size() * 2; ++i) {
+			ConflationSlot &slot = shard.conflation[i];
+			if (slot.event.version() == slot.applied.load(std::memory_order_relaxed)) continue;
+			const std::uint64_t version = slot.event.load(e);
+			apply_event(shard, e);
+			slot.applied.store(version, std::memory_order_release);
+			++applied;
+		}
+	}
+	return applied;
+}
+
+std::uint64_t ShardedState::latest(InstrumentId id, InstrumentQuote &out) const {
+	if (id >= published_count_) return 0;
+	return published_[id].quote.load(out);
+}
+
+std::uint64_t ShardedState::latest_version(InstrumentId id) const {
+	if (id >= published_count_) return 0;
+	return published_[id].quote.version();
+}
+
+void ShardedState::close_shard(std::size_t index, const TimeBucket &bucket) {
+	Shard &shard = *shards_[index];
+	shard.rows.clear();
+	shard.rows.reserve(shard.state.size());
+	for (std::size_t local = 0; local < shard.state.size(); ++local) {
+		const Instrument &inst = registry_.get(shard.ids[local]);
+		InMemoryState &s = shard.state[local];
+		MinuteSnapshot r{};
+		r.minute_unix = bucket.start_ms / 1000;
+		r.bucket_start_ms = bucket.start_ms;
+		r.bucket_width_ms = bucket.width_ms;
+		r.exchange = inst.exchange;
+		r.symbol = inst.symbol;
+		r.scale = inst.scale;
+		r.last_price = s.last_price;
+		r.best_bid_price = s.best_bid_price;
+		r.best_bid_amount = s.best_bid_amount;
+		r.best_ask_price = s.best_ask_price;
+		r.best_ask_amount = s.best_ask_amount;
+		s.bucket.close_into(r, bucket.end_ms());
+		shard.rows.push_back(std::move(r));
+	}
+	for (const std::uint32_t group : shard.groups) consolidated_->close_group(group, bucket);
+}
+
+void ShardedState::run_shard(std::size_t index) {
+	Shard &shard = *shards_[index];
+	int idle = 0;
+	for (;;) {
+		const bool busy = drain(shard) > 0;
+
+		const std::uint64_t rotate = shard.rotate_seq.load(std::memory_order_acquire);
+		if (rotate != shard.done_seq) {
+			drain(shard);
+			close_shard(index, TimeBucket{ shard.rotate_start_ms.load(std::memory_order_relaxed),
+				shard.rotate_width_ms.load(std::memory_order_relaxed) });
+			{
+				std::lock_guard<std::mutex> lk(shard.mu);
+				shard.done_seq = rotate;
+			}
+			shard.done_cv.notify_all();
+			continue;
+		}
+		if (shard.stopping.load(std::memory_order_acquire)) {
+			drain(shard);
+			return;
+		}
+		if (busy) {
+			idle = 0;
+			continue;
+		}
+		if (++idle < kIdleSpins) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		// Park until a producer, a rotation or stop() wakes us
+		std::unique_lock<std::mutex> lk(shard.mu);
+		shard.sleeping.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const bool pending = shard.ring.size() > 0
+			|| shard.conflation_writes.load(std::memory_order_relaxed) != shard.seen_conflation_writes
+			|| shard.rotate_seq.load(std::memory_order_relaxed) != shard.done_seq
+			|| shard.stopping.load(std::memory_order_relaxed);
+		if (!pending) shard.cv.wait_for(lk, std::chrono::milliseconds(1));
+		shard.sleeping.store(false, std::memory_order_relaxed);
+		idle = 0;
+	}
+}
+
+std::vector<MinuteSnapshot> ShardedState::snapshot_and_rotate(const TimeBucket &bucket) {
+	std::vector<MinuteSnapshot> rows;
+	rows.reserve(registry_.size());
+	if (!running_) {
+		// No workers: the caller owns every shard
+		for (std::size_t i = 0; i < shards_.size(); ++i) {
+			drain(*shards_[i]);
+			close_shard(i, bucket);
+			std::move(shards_[i]->rows.begin(), shards_[i]->rows.end(), std::back_inserter(rows));
+		}
+		return rows;
+	}
+
+	// Every worker closes its own instruments concurrently; the others keep ingesting
+	const std::uint64_t seq = ++rotate_seq_;
+	for (auto &s : shards_) {
+		s->rotate_start_ms.store(bucket.start_ms, std::memory_order_relaxed);
+		s->rotate_width_ms.store(bucket.width_ms, std::memory_order_relaxed);
+		s->rotate_seq.store(seq, std::memory_order_release);
+		wake(*s);
+	}
+	for (auto &s : shards_) {
+		std::unique_lock<std::mutex> lk(s->mu);
+		s->done_cv.wait(lk, [&]{ return s->done_seq == seq; });
+		lk.unlock();
+		std::move(s->rows.begin(), s->rows.end(), std::back_inserter(rows));
+	}
+	return rows;
+}
+
+EventQueueStats ShardedState::queue_stats(std::size_t shard) const {
+	const Shard &s = *shards_.at(shard);
+	EventQueueStats st;
+	st.capacity = s.ring.capacity();
+	st.depth = s.ring.size();
+	st.pushed = s.ring.pushed();
+	st.dropped = s.dropped.load(std::memory_order_relaxed);
+	st.conflated = s.conflated.load(std::memory_order_relaxed);
+	st.blocked = s.blocked.load(std::memory_order_relaxed);
+	return st;
+}
+
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "market_event.hpp"
+#include "event_ring.hpp"
+#include "bucket_stats.hpp"
+#include "cache_line.hpp"
+#include "instrument_registry.hpp"
+#include "seqlock.hpp"
+#include "time_utils.hpp"
+#include "metrics/latency_monitor.hpp"
+#include "storage/storage_writer.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace strategia {
+
+class ConsolidatedBook;
+class TopOfBookPublisher;
+
+// One cache line per instrument so neighbouring instruments never share a line.
+// Fixed point at the instrument's scale, kNullFixed until first seen.
+struct alignas(kCacheLineSize) InMemoryState {
+	std::int64_t last_price = kNullFixed;
+	std::int64_t best_bid_price = kNullFixed;
+	std::int64_t best_bid_amount = kNullFixed;
+	std::int64_t best_ask_price = kNullFixed;
+	std::int64_t best_ask_amount = kNullFixed;
+	BucketStats bucket;
+};
+
+// Latest state of one instrument as its shard worker applied it. Fixed point
+// at the instrument's scale (registry().get(id).scale), kNullFixed until seen.
+struct InstrumentQuote {
+	std::int64_t last_price = kNullFixed;
+	std::int64_t bid_price = kNullFixed;
+	std::int64_t bid_amount = kNullFixed;
+	std::int64_t ask_price = kNullFixed;
+	std::int64_t ask_amount = kNullFixed;
+	std::int64_t ts_ms = 0; // exchange time of the latest event applied
+};
+
+// What a feed thread does when its shard's ring is full
+enum class OverflowPolicy {
+	Block,      // spin until the worker frees a slot
+	DropOldest, // evict the oldest queued event
+	Conflate    // park the event in a per-instrument slot; newer ones overwrite it
+};
+
+struct EventQueueStats {
+	std::size_t capacity = 0;
+	std::size_t depth = 0;
+	std::uint64_t pushed = 0;
+	std::uint64_t dropped = 0;   // DropOldest evictions
+	std::uint64_t conflated = 0; // events parked in a conflation slot instead of the ring
+	std::uint64_t blocked = 0;   // Block pushes that found the ring full
+};
+
+// Per-instrument state partitioned over worker threads by instrument id
+// (id % shards, unless an affinity places it with related instruments).
+// Feed threads push fixed-size events into the owning shard's lock-free ring
+// and never wait on the worker unless the ring is full under
+// OverflowPolicy::Block. Each worker is the sole writer of its instruments.
+// Rotation asks every worker to close its own buckets once it has applied
+// everything queued before the request, so no lock spans all instruments.
+class ShardedState {
+public:
+	explicit ShardedState(std::size_t shards, std::size_t queue_capacity = 65536,
+		OverflowPolicy overflow = OverflowPolicy::Block);
+	~ShardedState();
+
+	ShardedState(const ShardedState&) = delete;
+	ShardedState &operator=(const ShardedState&) = delete;
+
+	// Register everything before start(); the registry is read-only afterwards.
+	// Events of the instrument carry prices and amounts at scale. Instruments
+	// registered with the same non-empty affinity land on the same shard.
+	InstrumentId register_instrument(const std::string &exchange, const std::string &symbol, FixedScale scale = {},
+		const std::string &affinity = {});
+
+	// Records parse-to-apply latency of every event that carries parsed_ns; call before start()
+	void set_latency_monitor(LatencyMonitor *monitor) { latency_ = monitor; }
+	// Mirrors every published state into shared memory as well, shard i
+	// writing ring i; call before start(). Must outlive the workers.
+	void set_publisher(TopOfBookPublisher *publisher) { publisher_ = publisher; }
+	// Feeds every applied quote to the book on the owning worker, which also
+	// closes the book's groups at rotation; call before start(). The venues of
+	// one consolidated symbol must share a shard (register them with the
+	// book's group_name() as affinity), else start() throws std::logic_error.
+	// Must outlive the workers.
+	void set_consolidated_book(ConsolidatedBook *book) { consolidated_ = book; }
+
+	void start();
+	void stop(); // applies what is already queued, then joins the workers
+
+	void on_ticker(const TickerData &t) { post(MarketEvent::ticker(t)); }
+	void on_orderbook(const OrderBookData &o) { post(MarketEvent::quote(o)); }
+	// Under Conflate, events of one instrument must come from one thread.
+	void post(const MarketEvent &e);
+
+	// One row per instrument for the bucket being closed; bucket stats
+	// restart, last price and best bid/ask roll over.
+	std::vector<MinuteSnapshot> snapshot_and_rotate(const TimeBucket &bucket);
+
+	// Latest state of an instrument for readers on any thread, once start()
+	// has returned. Workers publish it through a per-instrument seqlock after
+	// every event and never wait for readers; a read copies one cache line
+	// and retries only while that instrument is being written. Returns the
+	// version, which grows with every update (0 for an unknown id), so
+	// pollers can tell a new state from one they have seen.
+	std::uint64_t latest(InstrumentId id, InstrumentQuote &out) const;
+	// The version alone, for polling without copying
+	std::uint64_t latest_version(InstrumentId id) const;
+
+	std::size_t shard_count() const { return shards_.size(); }
+	const InstrumentRegistry &registry() const { return registry_; }
+	EventQueueStats queue_stats(std::size_t shard) const;
+
+private:
+	// Latest overflowed event of one kind for one instrument. It is pending
+	// while the seqlock version differs from the one the worker last applied.
+	struct ConflationSlot {
+		Seqlock<MarketEvent> event;
+		// The seqlock starts at version 2; a slot never stored to is not pending
+		std::atomic<std::uint64_t> applied{event.version()};
+	};
+
+	// A line of its own per instrument: neighbours belong to other workers
+	struct alignas(kCacheLineSize) PublishedQuote {
+		Seqlock<InstrumentQuote> quote;
+	};
+	static_assert(sizeof(PublishedQuote) == kCacheLineSize);
+
+	struct Shard {
+		explicit Shard(std::size_t capacity) : ring(capacity) {}
+
+		EventRing<MarketEvent> ring;
+		std::unique_ptr<ConflationSlot[]> conflation; // 2 per instrument (ticker, quote)
+		alignas(kCacheLineSize) std::atomic<std::uint64_t> conflation_writes{0};
+		std::atomic<std::uint64_t> dropped{0};
+		std::atomic<std::uint64_t> conflated{0};
+		std::atomic<std::uint64_t> blocked{0};
+
+		// Idle worker parking; producers only lock mu when sleeping is set
+		alignas(kCacheLineSize) std::atomic<bool> sleeping{false};
+		std::mutex mu;
+		std::condition_variable cv;
+		std::condition_variable done_cv; // rotation finished
+
+		std::atomic<std::uint64_t> rotate_seq{0}; // last requested rotation
+		std::atomic<std::int64_t> rotate_start_ms{0};
+		std::atomic<std::int64_t> rotate_width_ms{0};
+		std::uint64_t done_seq = 0; // guarded by mu; last finished rotation
+		std::atomic<bool> stopping{false};
+
+		std::vector<InMemoryState> state; // worker-owned, indexed by local_of_[id]
+		std::vector<InstrumentId> ids;    // by local index
+		std::vector<std::uint32_t> groups; // consolidated groups this worker owns
+		std::vector<MinuteSnapshot> rows; // output of the last rotation
+		std::uint64_t seen_conflation_writes = 0; // worker-owned
+		std::thread worker;
+	};
+
+	void run_shard(std::size_t index);
+	std::size_t drain(Shard &shard);
+	void apply_event(Shard &shard, const MarketEvent &e);
+	void close_shard(std::size_t index, const TimeBucket &bucket);
+	void overflow(Shard &shard, const MarketEvent &e);
+	static void wake(Shard &shard);
+	static void apply(InMemoryState &s, const MarketEvent &e);
+
+	InstrumentRegistry registry_;
+	std::vector<std::unique_ptr<Shard>> shards_;
+	std::vector<std::uint32_t> shard_of_; // by InstrumentId
+	std::vector<std::uint32_t> local_of_; // index into its shard's state, by InstrumentId
+	std::unordered_map<std::string, std::uint32_t> affinity_shard_;
+	std::unique_ptr<PublishedQuote[]> published_; // by InstrumentId, allocated by start()
+	std::size_t published_count_ = 0;
+	OverflowPolicy overflow_;
+	LatencyMonitor *latency_ = nullptr;
+	TopOfBookPublisher *publisher_ = nullptr;
+	ConsolidatedBook *consolidated_ = nullptr;
+	std::vector<std::size_t> latency_exchange_; // LatencyMonitor exchange index per InstrumentId
+	std::uint64_t rotate_seq_ = 0; // rotating thread only
+	bool running_ = false;
+};
+
+}
@@ -1,190 +1,283 @@
 #include "config.hpp"
 #include "time_utils.hpp"
-#include "exchanges/binance_client.hpp"
-#include "exchanges/okx_client.hpp"
-#include "storage/csv_writer.hpp"
-#ifdef STRATEGIA_ENABLE_POSTGRES
-#include "storage/postgres_writer.hpp"
+#include "aggregation/aggregation_sink.hpp"
+#include "aggregation/bucket_scheduler.hpp"
+#include "aggregation/consolidated_book.hpp"
+#include "aggregation/rollup.hpp"
+#include "aggregation/sharded_state.hpp"
+#include "exchanges/exchange_factory.hpp"
+#include "journal/frame_journal.hpp"
+#include "metrics/latency_monitor.hpp"
+#include "metrics/metrics_server.hpp"
+#include "shm/top_of_book_publisher.hpp"
+#include "storage/storage_factory.hpp"
+#ifdef STRATEGIA_ENABLE_REST_BACKFILL
+#include "exchanges/rest_backfill.hpp"
+#include "metrics/clock_sync.hpp"
 #endif
 
-#include <mutex>
-#include <unordered_map>
+#include <vector>
 #include <thread>
 #include <atomic>
 #include <condition_variable>
-#ifdef STRATEGIA_ENABLE_REST_BACKFILL
-#include <cpr/cpr.h>
-#endif
-#include <nlohmann/json.hpp>
+#include <iostream>
+#include <stdexcept>
 
 namespace strategia {
 
-struct InMemoryState {
-	std::optional<double> last_price;
-	std::optional<double> best_bid_price;
-	std::optional<double> best_bid_amount;
-	std::optional<double> best_ask_price;
-	std::optional<double> best_ask_amount;
-};
+static OverflowPolicy overflow_policy(const std::string &name) {
+	if (name == "block") return OverflowPolicy::Block;
+	if (name == "drop-oldest") return OverflowPolicy::DropOldest;
+	if (name == "conflate") return OverflowPolicy::Conflate;
+	throw std::invalid_argument("unknown event overflow policy: " + name);
+}
 
 class Aggregator {
 public:
 	Aggregator(Config cfg)
-		: cfg_(std::move(cfg)) {}
+		: cfg_(std::move(cfg))
+		, shards_(cfg_.aggregation_shards, cfg_.event_queue_capacity, overflow_policy(cfg_.event_overflow)) {
+		if (!cfg_.consolidated_csv.empty()) {
+			consolidated_ = std::make_unique<ConsolidatedBook>(cfg_.venue_fees_bps, cfg_.consolidated_symbol_map,
+				cfg_.consolidated_max_quote_age_ms);
+		}
+	}
 
 	void run() {
-		CsvWriter csv(cfg_.csv_output_dir);
-		StorageWriter *writer = &csv;
-#ifdef STRATEGIA_ENABLE_POSTGRES
-		std::unique_ptr<PostgresWriter> pg;
-		if (cfg_.enable_postgres && !cfg_.postgres_dsn.empty()) {
-			pg = std::make_unique<PostgresWriter>(cfg_.postgres_dsn);
-			writer = pg.get();
+		BucketScheduler scheduler(parse_duration_ms(cfg_.bucket_width));
+		RollupPipeline rollups(scheduler.width_ms(), parse_rollup_widths(cfg_.rollups));
+		const std::unique_ptr<StorageWriter> writer = make_storage_writer(cfg_);
+
+		std::unique_ptr<MetricsServer> metrics_server;
+		if (cfg_.metrics_port != 0) {
+			metrics_server = std::make_unique<MetricsServer>(MetricsRegistry::global(), cfg_.metrics_bind, cfg_.metrics_port);
+			std::cerr << "Metrics on http://" << cfg_.metrics_bind << ":" << metrics_server->port() << "/metrics\n";
 		}
-#endif
-		writer->ensure_schema();
 
-		// Add test data to verify REST backfill and CSV writing
-		{
-			std::lock_guard<std::mutex> lk(mu_);
-			state_["binance:BTCUSDT"] = InMemoryState{};
-			state_["okx:BTC-USDT"] = InMemoryState{};
+		// Register instruments up front: they get rows (and REST backfill) even before the first tick
+		const InstrumentScales scales(cfg_.instrument_scales);
+		std::vector<Subscription> binance_subs, okx_subs;
+		auto subscribe = [&](const std::string &exchange, const std::string &symbol, std::vector<Subscription> &subs) {
+			const FixedScale scale = scales.of(exchange, symbol);
+			// The venues of a consolidated symbol share a shard worker, which ranks them
+			const std::string group = consolidated_ ? consolidated_->group_name(exchange, symbol) : std::string();
+			const InstrumentId id = shards_.register_instrument(exchange, symbol, scale, group);
+			if (consolidated_) consolidated_->add_instrument(id, exchange, symbol, scale);
+			subs.push_back({symbol, id, scale});
+		};
+		for (const auto &s : cfg_.symbols_binance) subscribe("binance", s, binance_subs);
+		for (const auto &s : cfg_.symbols_okx) subscribe("okx", s, okx_subs);
+		shards_.set_consolidated_book(consolidated_.get());
+
+		const bool latency_report = !cfg_.latency_csv.empty();
+		if (latency_report) shards_.set_latency_monitor(&latency_);
+		if (!cfg_.shm_name.empty()) {
+			publisher_ = std::make_unique<TopOfBookPublisher>(cfg_.shm_name, shards_.registry(),
+				shards_.shard_count(), cfg_.shm_ring_capacity);
+			shards_.set_publisher(publisher_.get());
+			std::cerr << "Top of book in shared memory " << cfg_.shm_name << "\n";
+		}
+		shards_.start();
+		for (std::size_t i = 0; i < shards_.shard_count(); ++i) queue_metrics_.push_back(QueueMetrics::make(i));
+
+		// Outlives the clients, which append to it from their receive threads
+		std::unique_ptr<FrameJournal> journal;
+		if (!cfg_.journal_dir.empty()) {
+			journal = std::make_unique<FrameJournal>(cfg_.journal_dir, cfg_.journal_segment_mb << 20);
 		}
 
-		BinanceClient binance(cfg_.symbol_binance);
-		OkxClient okx(cfg_.symbol_okx);
+		const AggregationSink sink{&shards_};
+		std::vector<std::unique_ptr<ExchangeClient>> clients;
+		clients.push_back(make_exchange_client(Exchange::Binance, std::move(binance_subs), sink, cfg_.binance_streams_per_connection));
+		clients.push_back(make_exchange_client(Exchange::Okx, std::move(okx_subs), sink, cfg_.okx_instruments_per_connection));
 
 #ifdef STRATEGIA_ENABLE_WEBSOCKETS
-		binance.set_ticker_callback([this](const TickerData &t){ on_ticker(t); });
-		okx.set_ticker_callback([this](const TickerData &t){ on_ticker(t); });
-		binance.set_orderbook_callback([this](const OrderBookData &o){ on_orderbook(o); });
-		okx.set_orderbook_callback([this](const OrderBookData &o){ on_orderbook(o); });
-
-		binance.start();
-		okx.start();
+		for (auto &client : clients) {
+			client->set_journal(journal.get());
+			if (latency_report) client->set_latency_monitor(&latency_);
+			client->start();
+		}
 #endif
 
 		std::atomic<bool> running{true};
-		std::thread flusher([&]{
-			std::int64_t current_bucket = minute_bucket_unix(current_unix_seconds());
-			while (running.load()) {
-				std::this_thread::sleep_for(std::chrono::seconds(1));
-				auto now = current_unix_seconds();
-				auto bucket = minute_bucket_unix(now);
-				if (bucket > current_bucket) {
-					// finalize previous minute
-					auto rows = snapshot_and_rotate(current_bucket);
-					// If no last price for some symbols, backfill via REST
 #ifdef STRATEGIA_ENABLE_REST_BACKFILL
-					for (auto &row : rows) {
-						if (!row.last_price) {
-							if (row.exchange == "binance") {
-								try {
-#ifdef STRATEGIA_USE_LIBCURL_REST
-									long sc = 0; auto body = HttpClient::get(std::string("https://api.binance.com/api/v3/ticker/price?symbol=") + row.symbol, sc);
-									if (sc == 200) { auto j = nlohmann::json::parse(body); row.last_price = std::stod(j.value("price", "0")); }
-#else
-									auto r = cpr::Get(cpr::Url{ "https://api.binance.com/api/v3/ticker/price" }, cpr::Parameters{{"symbol", row.symbol}});
-									if (r.status_code == 200) { auto j = nlohmann::json::parse(r.text); row.last_price = std::stod(j.value("price", "0")); }
-#endif
-								} catch (...) {}
-							} else if (row.exchange == "okx") {
-								try {
-#ifdef STRATEGIA_USE_LIBCURL_REST
-									long sc = 0; auto body = HttpClient::get(std::string("https://www.okx.com/api/v5/market/ticker?instId=") + row.symbol, sc);
-									if (sc == 200) { auto j = nlohmann::json::parse(body); if (j.contains("data") && !j["data"].empty()) { row.last_price = std::stod(j["data"][0].value("last", "0")); } }
-#else
-									auto r = cpr::Get(cpr::Url{ "https://www.okx.com/api/v5/market/ticker" }, cpr::Parameters{{"instId", row.symbol}});
-									if (r.status_code == 200) { auto j = nlohmann::json::parse(r.text); if (j.contains("data") && !j["data"].empty()) { row.last_price = std::stod(j["data"][0].value("last", "0")); } }
-#endif
-								} catch (...) {}
-							}
-							// Backfill top-of-book if missing
-							if (!row.best_bid_price || !row.best_ask_price) {
-								if (row.exchange == "binance") {
-									try {
-#ifdef STRATEGIA_USE_LIBCURL_REST
-										long sc = 0; auto body = HttpClient::get(std::string("https://api.binance.com/api/v3/depth?symbol=") + row.symbol + "&limit=5", sc);
-										if (sc == 200) { auto j = nlohmann::json::parse(body); if (j.contains("bids") && !j["bids"].empty()) { row.best_bid_price = std::stod(j["bids"][0][0].get<std::string>()); row.best_bid_amount = std::stod(j["bids"][0][1].get<std::string>()); } if (j.contains("asks") && !j["asks"].empty()) { row.best_ask_price = std::stod(j["asks"][0][0].get<std::string>()); row.best_ask_amount = std::stod(j["asks"][0][1].get<std::string>()); } }
-#else
-										auto r = cpr::Get(cpr::Url{ "https://api.binance.com/api/v3/depth" }, cpr::Parameters{{"symbol", row.symbol}, {"limit", "5"}});
-										if (r.status_code == 200) { auto j = nlohmann::json::parse(r.text); if (j.contains("bids") && !j["bids"].empty()) { row.best_bid_price = std::stod(j["bids"][0][0].get<std::string>()); row.best_bid_amount = std::stod(j["bids"][0][1].get<std::string>()); } if (j.contains("asks") && !j["asks"].empty()) { row.best_ask_price = std::stod(j["asks"][0][0].get<std::string>()); row.best_ask_amount = std::stod(j["asks"][0][1].get<std::string>()); } }
-#endif
-									} catch (...) {}
-								} else if (row.exchange == "okx") {
-									try {
-#ifdef STRATEGIA_USE_LIBCURL_REST
-										long sc = 0; auto body = HttpClient::get(std::string("https://www.okx.com/api/v5/market/books?instId=") + row.symbol + "&sz=5", sc);
-										if (sc == 200) { auto j = nlohmann::json::parse(body); if (j.contains("data") && !j["data"].empty()) { auto &d = j["data"][0]; if (d.contains("bids") && !d["bids"].empty()) { row.best_bid_price = std::stod(d["bids"][0][0].get<std::string>()); row.best_bid_amount = std::stod(d["bids"][0][1].get<std::string>()); } if (d.contains("asks") && !d["asks"].empty()) { row.best_ask_price = std::stod(d["asks"][0][0].get<std::string>()); row.best_ask_amount = std::stod(d["asks"][0][1].get<std::string>()); } } }
-#else
-										auto r = cpr::Get(cpr::Url{ "https://www.okx.com/api/v5/market/books" }, cpr::Parameters{{"instId", row.symbol}, {"sz", "5"}});
-										if (r.status_code == 200) { auto j = nlohmann::json::parse(r.text); if (j.contains("data") && !j["data"].empty()) { auto &d = j["data"][0]; if (d.contains("bids") && !d["bids"].empty()) { row.best_bid_price = std::stod(d["bids"][0][0].get<std::string>()); row.best_bid_amount = std::stod(d["bids"][0][1].get<std::string>()); } if (d.contains("asks") && !d["asks"].empty()) { row.best_ask_price = std::stod(d["asks"][0][0].get<std::string>()); row.best_ask_amount = std::stod(d["asks"][0][1].get<std::string>()); } } }
+		// The clock offset only corrects latency samples
+		std::thread clock_sync;
+		if (latency_report) clock_sync = std::thread([&]{
+			while (running.load()) {
+				for (const char *exchange : {"binance", "okx"}) {
+					const std::size_t idx = latency_.find_exchange(exchange);
+					if (idx == LatencyMonitor::kNoExchange) continue;
+					try {
+						if (const auto offset = estimate_clock_offset(exchange)) latency_.set_clock_offset(idx, *offset);
+					} catch (const std::exception &e) {
+						std::cerr << "Clock sync with " << exchange << ": " << e.what() << "\n";
+					}
+				}
+				for (long s = 0; s < cfg_.clock_sync_interval_s && running.load(); ++s) {
+					std::this_thread::sleep_for(std::chrono::seconds(1));
+				}
+			}
+		});
 #endif
-									} catch (...) {}
-								}
-							}
-						}
+		const std::size_t collector = MetricsRegistry::global().add_collector([this, &journal]{ publish_metrics(journal.get()); });
+
+		std::thread flusher([&]{
+			// Latency percentiles and overflow reports stay per minute whatever the bucket width
+			std::int64_t report_minute = current_unix_millis() / kMinuteMs * 60;
+			std::uint64_t journal_dropped = 0;
+			std::vector<MinuteSnapshot> rolled;
+			// A failed batch (full disk, too many open files) is logged and
+			// counted by the writer; the next bucket tries again
+			auto write = [&writer](const std::vector<MinuteSnapshot> &batch, const char *what) {
+				if (batch.empty()) return;
+				try {
+					writer->write_batch(batch);
+				} catch (const std::exception &e) {
+					std::cerr << "Storage (" << what << "): " << e.what() << "\n";
+				}
+			};
+			while (const auto bucket = scheduler.wait_close()) {
+				auto started = std::chrono::steady_clock::now();
+				auto rows = shards_.snapshot_and_rotate(*bucket);
+				rotate_duration_.observe_ns(elapsed_ns(started));
+				bucket_rows_.set(static_cast<std::int64_t>(rows.size()));
+				// If no last price for some symbols, backfill via REST. Sub-minute
+				// buckets close faster than the round trips, so they are left as is.
+#ifdef STRATEGIA_ENABLE_REST_BACKFILL
+				if (bucket->width_ms >= kMinuteMs) {
+					started = std::chrono::steady_clock::now();
+					const auto deadline = started + std::chrono::milliseconds(cfg_.backfill_deadline_ms);
+					if (const auto missed = backfill_missing(rows, deadline)) {
+						backfill_missed_.inc(missed);
+						std::cerr << "REST backfill: " << missed << " request(s) failed or missed the deadline\n";
+					}
+					backfill_duration_.observe_ns(elapsed_ns(started));
+				}
 #endif
+				write(rows, "buckets");
+				rolled.clear();
+				rollups.add(rows, rolled);
+				write(rolled, "rollups");
+				if (consolidated_) {
+					try {
+						append_consolidated_csv(cfg_.consolidated_csv, consolidated_->venues(), consolidated_->closed());
+					} catch (const std::exception &e) {
+						std::cerr << "Consolidated stats: " << e.what() << "\n";
 					}
-					if (!rows.empty()) writer->write_batch(rows);
-					current_bucket = bucket;
 				}
+
+				const std::int64_t minute = bucket->end_ms() / kMinuteMs * 60;
+				if (minute <= report_minute) continue;
+				if (latency_report) {
+					try {
+						append_latency_csv(cfg_.latency_csv, report_minute, latency_.collect());
+					} catch (const std::exception &e) {
+						std::cerr << "Latency stats: " << e.what() << "\n";
+					}
+				}
+				report_queue_overflow();
+				if (journal && journal->frames_dropped() != journal_dropped) {
+					std::cerr << "Journal dropped " << journal->frames_dropped() - journal_dropped << " frame(s)\n";
+					journal_dropped = journal->frames_dropped();
+				}
+				report_minute = minute;
 			}
 		});
 
 		// Блокируемся навсегда (остановка процессом/сервисом)
 		flusher.join();
+		running.store(false);
+#ifdef STRATEGIA_ENABLE_REST_BACKFILL
+		if (clock_sync.joinable()) clock_sync.join();
+#endif
+		MetricsRegistry::global().remove_collector(collector);
 	}
 
 private:
-	void on_ticker(const TickerData &t) {
-		std::lock_guard<std::mutex> lk(mu_);
-		auto &state = state_[t.exchange + ":" + t.symbol];
-		state.last_price = t.price;
+	struct QueueMetrics {
+		Gauge &depth;
+		Counter &pushed;
+		Counter &dropped;
+		Counter &conflated;
+		Counter &blocked;
+		EventQueueStats seen;
+
+		static QueueMetrics make(std::size_t shard) {
+			auto &registry = MetricsRegistry::global();
+			const std::string id = std::to_string(shard);
+			auto events = [&](const char *outcome) -> Counter & {
+				return registry.counter("strategia_events_total", "Feed events offered to a shard ring, by outcome",
+					{{"shard", id}, {"outcome", outcome}});
+			};
+			return QueueMetrics{registry.gauge("strategia_event_queue_depth", "Events waiting in a shard ring", {{"shard", id}}),
+				events("pushed"), events("dropped"), events("conflated"), events("blocked"), {}};
+		}
+	};
+
+	static std::int64_t elapsed_ns(std::chrono::steady_clock::time_point since) {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - since).count();
 	}
 
-	void on_orderbook(const OrderBookData &o) {
-		std::lock_guard<std::mutex> lk(mu_);
-		auto &state = state_[o.exchange + ":" + o.symbol];
-		if (!o.bids.empty()) {
-			state.best_bid_price = o.bids.front().price;
-			state.best_bid_amount = o.bids.front().amount;
+	// Copies queue and journal statistics into the registry; runs on the scraping thread
+	void publish_metrics(const FrameJournal *journal) {
+		for (std::size_t i = 0; i < queue_metrics_.size(); ++i) {
+			const EventQueueStats st = shards_.queue_stats(i);
+			QueueMetrics &q = queue_metrics_[i];
+			q.depth.set(static_cast<std::int64_t>(st.depth));
+			q.pushed.inc(st.pushed - q.seen.pushed);
+			q.dropped.inc(st.dropped - q.seen.dropped);
+			q.conflated.inc(st.conflated - q.seen.conflated);
+			q.blocked.inc(st.blocked - q.seen.blocked);
+			q.seen = st;
 		}
-		if (!o.asks.empty()) {
-			state.best_ask_price = o.asks.front().price;
-			state.best_ask_amount = o.asks.front().amount;
+		if (journal) {
+			journal_written_.inc(journal->frames_written() - journal_seen_.first);
+			journal_dropped_.inc(journal->frames_dropped() - journal_seen_.second);
+			journal_seen_ = {journal->frames_written(), journal->frames_dropped()};
 		}
 	}
 
-	std::vector<MinuteSnapshot> snapshot_and_rotate(std::int64_t minute_bucket) {
-		std::vector<MinuteSnapshot> rows;
-		std::lock_guard<std::mutex> lk(mu_);
-		for (auto &kv : state_) {
-			const std::string &key = kv.first; // exchange:symbol
-			const auto colon = key.find(':');
-			if (colon == std::string::npos) continue;
-			std::string exchange = key.substr(0, colon);
-			std::string symbol = key.substr(colon + 1);
-			InMemoryState &s = kv.second;
-			MinuteSnapshot r{};
-			r.minute_unix = minute_bucket;
-			r.exchange = exchange;
-			r.symbol = symbol;
-			r.last_price = s.last_price;
-			r.best_bid_price = s.best_bid_price;
-			r.best_bid_amount = s.best_bid_amount;
-			r.best_ask_price = s.best_ask_price;
-			r.best_ask_amount = s.best_ask_amount;
-			rows.push_back(r);
+	// Logs shards whose ring overflowed since the previous call
+	void report_queue_overflow() {
+		overflow_seen_.resize(shards_.shard_count());
+		for (std::size_t i = 0; i < shards_.shard_count(); ++i) {
+			const EventQueueStats st = shards_.queue_stats(i);
+			EventQueueStats &prev = overflow_seen_[i];
+			if (st.dropped != prev.dropped || st.conflated != prev.conflated || st.blocked != prev.blocked) {
+				std::cerr << "Event queue " << i << " overflowed: depth " << st.depth << "/" << st.capacity
+					<< ", dropped " << st.dropped - prev.dropped
+					<< ", conflated " << st.conflated - prev.conflated
+					<< ", blocked " << st.blocked - prev.blocked << "\n";
+			}
+			prev = st;
 		}
-		// do not clear; keep rolling state for next minute
-		return rows;
 	}
 
 private:
 	Config cfg_;
-	std::mutex mu_;
-	std::unordered_map<std::string, InMemoryState> state_;
+	LatencyMonitor latency_;
+	std::unique_ptr<TopOfBookPublisher> publisher_; // outlives the shard workers
+	std::unique_ptr<ConsolidatedBook> consolidated_; // likewise; null unless consolidated_csv is set
+	ShardedState shards_;
+	std::vector<EventQueueStats> overflow_seen_; // flusher thread only
+
+	// Scraping thread only
+	std::vector<QueueMetrics> queue_metrics_;
+	std::pair<std::uint64_t, std::uint64_t> journal_seen_; // frames written, dropped
+	Counter &journal_written_ = MetricsRegistry::global().counter("strategia_journal_frames_total",
+		"Raw frames offered to the journal, by outcome", {{"outcome", "written"}});
+	Counter &journal_dropped_ = MetricsRegistry::global().counter("strategia_journal_frames_total",
+		"Raw frames offered to the journal, by outcome", {{"outcome", "dropped"}});
+
+	DurationHistogram &rotate_duration_ = MetricsRegistry::global().histogram("strategia_rotate_duration_seconds",
+		"Time to snapshot and reset all instruments at a bucket boundary");
+	DurationHistogram &backfill_duration_ = MetricsRegistry::global().histogram("strategia_backfill_duration_seconds",
+		"Time spent on REST backfill per bucket");
+	Counter &backfill_missed_ = MetricsRegistry::global().counter("strategia_backfill_missed_total",
+		"REST backfill requests that failed or missed the deadline");
+	Gauge &bucket_rows_ = MetricsRegistry::global().gauge("strategia_bucket_rows",
+		"Rows in the most recently closed bucket");
 };
 
 void run_service(const Config &cfg) {
@@ -0,0 +1,87 @@
+#include "book_sync.hpp"
+
+namespace strategia {
+
+BookSyncStatus BinanceBookSync::request_snapshot() {
+	if (snapshot_requested_) return BookSyncStatus::Pending;
+	snapshot_requested_ = true;
+	return BookSyncStatus::NeedSnapshot;
+}
+
+void BinanceBookSync::apply(const PendingDiff &d) {
+	for (const auto &l : d.bids) book_.apply_bid(l.price, l.amount);
+	for (const auto &l : d.asks) book_.apply_ask(l.price, l.amount);
+	last_update_id_ = d.last_update_id;
+}
+
+BookSyncStatus BinanceBookSync::on_update(const BookUpdate &u) {
+	if (synced_) {
+		if (u.last_update_id <= last_update_id_) return BookSyncStatus::Pending;
+		if (u.first_update_id <= last_update_id_ + 1) {
+			for (const auto &l : u.bids) book_.apply_bid(l.price, l.amount);
+			for (const auto &l : u.asks) book_.apply_ask(l.price, l.amount);
+			last_update_id_ = u.last_update_id;
+			return BookSyncStatus::Applied;
+		}
+		// gap: drop the book and rebuild it from a new snapshot
+		synced_ = false;
+		book_.clear();
+	}
+	if (pending_.size() >= kMaxPending) pending_.clear();
+	PendingDiff d;
+	d.first_update_id = u.first_update_id;
+	d.last_update_id = u.last_update_id;
+	d.bids.reserve(u.bids.size());
+	d.asks.reserve(u.asks.size());
+	for (const auto &l : u.bids) d.bids.push_back({l.price, l.amount});
+	for (const auto &l : u.asks) d.asks.push_back({l.price, l.amount});
+	pending_.push_back(std::move(d));
+	return request_snapshot();
+}
+
+BookSyncStatus BinanceBookSync::on_snapshot(std::int64_t last_update_id,
+	const std::vector<OrderBookLevel> &bids, const std::vector<OrderBookLevel> &asks) {
+	snapshot_requested_ = false;
+	// Snapshot older than the buffered stream: it cannot be bridged, fetch again
+	if (!pending_.empty() && last_update_id < pending_.front().first_update_id - 1) return request_snapshot();
+
+	book_.clear();
+	for (const auto &l : bids) book_.apply_bid(l.price, l.amount);
+	for (const auto &l : asks) book_.apply_ask(l.price, l.amount);
+	last_update_id_ = last_update_id;
+	for (const auto &d : pending_) {
+		if (d.last_update_id <= last_update_id_) continue;
+		if (d.first_update_id > last_update_id_ + 1) {
+			pending_.clear();
+			book_.clear();
+			return request_snapshot();
+		}
+		apply(d);
+	}
+	pending_.clear();
+	synced_ = true;
+	return BookSyncStatus::Applied;
+}
+
+BookSyncStatus OkxBookSync::resync() {
+	synced_ = false;
+	book_.clear();
+	return BookSyncStatus::Resync;
+}
+
+BookSyncStatus OkxBookSync::on_update(const BookUpdate &u) {
+	if (u.snapshot) {
+		book_.clear();
+	} else {
+		if (!synced_) return BookSyncStatus::Pending; // still waiting for the snapshot
+		if (u.first_update_id != seq_id_) return resync();
+	}
+	for (const auto &l : u.bids) book_.apply_bid(l.price, l.amount, l.price_text, l.amount_text);
+	for (const auto &l : u.asks) book_.apply_ask(l.price, l.amount, l.price_text, l.amount_text);
+	seq_id_ = u.last_update_id;
+	if (u.has_checksum && book_.text_ok() && book_.okx_checksum() != u.checksum) return resync();
+	synced_ = true;
+	return BookSyncStatus::Applied;
+}
+
+}
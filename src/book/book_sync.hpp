@@ -0,0 +1,71 @@
+#pragma once
+
+#include "order_book.hpp"
+#include "exchanges/frame_parser.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace strategia {
+
+enum class BookSyncStatus {
+	Applied,      // the book advanced and is consistent
+	Pending,      // nothing to publish yet (buffering, stale or empty push)
+	NeedSnapshot, // Binance: fetch a fresh REST snapshot and pass it to on_snapshot
+	Resync        // OKX: the book was dropped; resubscribe to get a new snapshot
+};
+
+// Binance diff-depth stream aligned with a REST snapshot using update ids:
+// diffs are buffered until a snapshot arrives, those already covered by it
+// (u <= lastUpdateId) are dropped, and afterwards every diff must satisfy
+// U <= last applied u + 1, otherwise the book is rebuilt from a new snapshot.
+class BinanceBookSync {
+public:
+	BookSyncStatus on_update(const BookUpdate &u);
+	BookSyncStatus on_snapshot(std::int64_t last_update_id,
+		const std::vector<OrderBookLevel> &bids, const std::vector<OrderBookLevel> &asks);
+
+	bool synced() const { return synced_; }
+	const OrderBook &book() const { return book_; }
+
+private:
+	struct PendingDiff {
+		std::int64_t first_update_id = 0;
+		std::int64_t last_update_id = 0;
+		std::vector<OrderBookLevel> bids;
+		std::vector<OrderBookLevel> asks;
+	};
+
+	// Caps memory if a snapshot never arrives; the buffer restarts from scratch
+	static constexpr std::size_t kMaxPending = 10000;
+
+	BookSyncStatus request_snapshot();
+	void apply(const PendingDiff &d);
+
+	OrderBook book_;
+	std::vector<PendingDiff> pending_;
+	bool synced_ = false;
+	bool snapshot_requested_ = false;
+	std::int64_t last_update_id_ = 0;
+};
+
+// OKX "books" channel: a snapshot push followed by incremental updates chained
+// by seqId/prevSeqId, each carrying a CRC32 checksum of the top 25 levels.
+class OkxBookSync {
+public:
+	OkxBookSync()
+		: book_(true) {}
+
+	BookSyncStatus on_update(const BookUpdate &u);
+
+	bool synced() const { return synced_; }
+	const OrderBook &book() const { return book_; }
+
+private:
+	BookSyncStatus resync();
+
+	OrderBook book_;
+	bool synced_ = false;
+	std::int64_t seq_id_ = 0;
+};
+
+}
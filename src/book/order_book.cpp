@@ -0,0 +1,51 @@
+#include "order_book.hpp"
+#include <array>
+
+namespace strategia {
+
+namespace {
+
+// Standard reflected CRC-32 (poly 0xEDB88320), as zlib computes it
+constexpr std::array<std::uint32_t, 256> make_crc_table() {
+	std::array<std::uint32_t, 256> t{};
+	for (std::uint32_t i = 0; i < 256; ++i) {
+		std::uint32_t c = i;
+		for (int k = 0; k < 8; ++k) c = (c & 1u) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+		t[i] = c;
+	}
+	return t;
+}
+
+constexpr auto kCrcTable = make_crc_table();
+
+// Operates on the inverted register; callers start from and finish with ~0
+std::uint32_t crc_update(std::uint32_t crc, const char *data, std::size_t n) {
+	for (std::size_t i = 0; i < n; ++i) crc = kCrcTable[(crc ^ static_cast<unsigned char>(data[i])) & 0xFFu] ^ (crc >> 8);
+	return crc;
+}
+
+}
+
+void OrderBook::clear() {
+	bids_.clear();
+	asks_.clear();
+	text_ok_ = keep_text_;
+}
+
+std::int32_t OrderBook::okx_checksum() const {
+	constexpr std::size_t kLevels = 25;
+	std::uint32_t crc = 0xFFFFFFFFu;
+	bool first = true;
+	auto add = [&](const LevelText &t) {
+		if (!first) crc = crc_update(crc, ":", 1);
+		crc = crc_update(crc, t.data, t.size);
+		first = false;
+	};
+	for (std::size_t i = 0; i < kLevels; ++i) {
+		if (i < bids_.size()) add(bids_.text(i));
+		if (i < asks_.size()) add(asks_.text(i));
+	}
+	return static_cast<std::int32_t>(~crc);
+}
+
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "exchanges/exchange_client.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace strategia {
+
+// Raw "price:amount" text of a level as the exchange sent it. OKX checksums
+// are defined over these strings, which trailing zeros make differ from the
+// fixed-point values.
+struct LevelText {
+	std::uint8_t size = 0;
+	char data[63];
+};
+
+// One side of a price-level book in a contiguous vector sorted worst-to-best:
+// the best level sits at the back, so the frequent near-touch inserts and
+// erases shift only a handful of elements, and a lookup is a binary search
+// over 16-byte levels instead of a tree walk.
+template <bool IsBid>
+class BookSide {
+public:
+	explicit BookSide(bool keep_text = false)
+		: keep_text_(keep_text) {}
+
+	std::size_t size() const { return levels_.size(); }
+	bool empty() const { return levels_.empty(); }
+	void clear() { levels_.clear(); text_.clear(); }
+
+	// i-th best level, 0 is the top of book
+	const OrderBookLevel &level(std::size_t i) const { return levels_[levels_.size() - 1 - i]; }
+	const LevelText &text(std::size_t i) const { return text_[text_.size() - 1 - i]; }
+
+	// Sets the amount at price; amount == 0 removes the level.
+	// Returns false only when the raw text does not fit into LevelText.
+	bool apply(std::int64_t price, std::int64_t amount, std::string_view price_text = {}, std::string_view amount_text = {}) {
+		auto it = std::lower_bound(levels_.begin(), levels_.end(), price,
+			[](const OrderBookLevel &l, std::int64_t p) { return IsBid ? l.price < p : l.price > p; });
+		const auto idx = static_cast<std::size_t>(it - levels_.begin());
+		const bool found = it != levels_.end() && it->price == price;
+		if (amount == 0) {
+			if (found) {
+				levels_.erase(it);
+				if (keep_text_) text_.erase(text_.begin() + static_cast<std::ptrdiff_t>(idx));
+			}
+			return true;
+		}
+		if (found) {
+			it->amount = amount;
+		} else {
+			levels_.insert(it, OrderBookLevel{price, amount});
+			if (keep_text_) text_.insert(text_.begin() + static_cast<std::ptrdiff_t>(idx), LevelText{});
+		}
+		return !keep_text_ || set_text(text_[idx], price_text, amount_text);
+	}
+
+	// Copies up to n best levels, best first
+	void top(std::size_t n, BookLevels &out) const {
+		out.clear();
+		n = std::min({n, levels_.size(), BookLevels::capacity()});
+		for (std::size_t i = 0; i < n; ++i) out.push_back(level(i));
+	}
+
+private:
+	static bool set_text(LevelText &t, std::string_view price_text, std::string_view amount_text) {
+		const std::size_t n = price_text.size() + 1 + amount_text.size();
+		if (n > sizeof(t.data)) { t.size = 0; return false; }
+		std::copy(price_text.begin(), price_text.end(), t.data);
+		t.data[price_text.size()] = ':';
+		std::copy(amount_text.begin(), amount_text.end(), t.data + price_text.size() + 1);
+		t.size = static_cast<std::uint8_t>(n);
+		return true;
+	}
+
+	bool keep_text_;
+	std::vector<OrderBookLevel> levels_;
+	std::vector<LevelText> text_; // parallel to levels_ when keep_text_
+};
+
+// Full-depth local L2 book for one instrument.
+class OrderBook {
+public:
+	explicit OrderBook(bool keep_text = false)
+		: bids_(keep_text), asks_(keep_text), keep_text_(keep_text), text_ok_(keep_text) {}
+
+	const BookSide<true> &bids() const { return bids_; }
+	const BookSide<false> &asks() const { return asks_; }
+
+	void clear();
+	void apply_bid(std::int64_t price, std::int64_t amount, std::string_view price_text = {}, std::string_view amount_text = {}) {
+		if (!bids_.apply(price, amount, price_text, amount_text)) text_ok_ = false;
+	}
+	void apply_ask(std::int64_t price, std::int64_t amount, std::string_view price_text = {}, std::string_view amount_text = {}) {
+		if (!asks_.apply(price, amount, price_text, amount_text)) text_ok_ = false;
+	}
+
+	// OKX checksum: signed CRC32 of "bid:amt:ask:amt:..." over the top 25
+	// levels, interleaving bids and asks. Only meaningful with keep_text.
+	std::int32_t okx_checksum() const;
+	// False once a level's text did not fit; checksums cannot be verified until clear()
+	bool text_ok() const { return text_ok_; }
+
+private:
+	BookSide<true> bids_;
+	BookSide<false> asks_;
+	bool keep_text_;
+	bool text_ok_;
+};
+
+// Points out at book and copies its n best levels per side
+inline void fill_top_levels(const OrderBook &book, std::size_t n, OrderBookData &out) {
+	book.bids().top(n, out.bids);
+	book.asks().top(n, out.asks);
+	out.book = &book;
+}
+
+}
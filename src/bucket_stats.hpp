@@ -0,0 +1,101 @@
+#pragma once
+
+#include "storage/storage_writer.hpp"
+#include <algorithm>
+#include <cstdint>
+
+namespace strategia {
+
+// Incremental per-bucket statistics, O(1) per tick. Trade-price bars come from
+// ticker prices; spread and the time-weighted mid come from top-of-book updates,
+// weighted by exchange timestamps. Prices are fixed point at the instrument's
+// scale, so min/max compare integers and sums are exact.
+struct BucketStats {
+	// last price bars
+	std::int64_t open = 0;
+	std::int64_t high = 0;
+	std::int64_t low = 0;
+	std::int64_t close = 0;
+	std::int64_t tick_count = 0;
+
+	// spread over book updates
+	std::int64_t quote_count = 0;
+	std::int64_t spread_min = 0;
+	std::int64_t spread_max = 0;
+	std::int64_t spread_sum = 0;
+
+	// mid weighted by how long it was in force; the last mid carries over
+	// buckets. Kept doubled (bid + ask) so it stays an integer.
+	double mid2_ms_sum = 0.0;
+	std::int64_t mid_ms = 0;
+	bool has_mid = false;
+	std::int64_t last_mid2 = 0;
+	std::int64_t last_mid_ts_ms = 0;
+	std::int64_t start_ms = 0; // bucket start; 0 until the first rotation
+
+	void on_price(std::int64_t price) {
+		if (tick_count++ == 0) {
+			open = high = low = price;
+		} else {
+			high = std::max(high, price);
+			low = std::min(low, price);
+		}
+		close = price;
+	}
+
+	void on_quote(std::int64_t bid, std::int64_t ask, std::int64_t ts_ms) {
+		const std::int64_t spread = ask - bid;
+		if (quote_count++ == 0) {
+			spread_min = spread_max = spread;
+		} else {
+			spread_min = std::min(spread_min, spread);
+			spread_max = std::max(spread_max, spread);
+		}
+		spread_sum += spread;
+		accrue_mid(ts_ms);
+		last_mid2 = bid + ask;
+		last_mid_ts_ms = ts_ms;
+		has_mid = true;
+	}
+
+	// Writes the bucket's columns into row, whose scale must be set, and
+	// starts the next bucket at end_ms
+	void close_into(MinuteSnapshot &row, std::int64_t end_ms) {
+		if (tick_count > 0) {
+			row.open = open;
+			row.high = high;
+			row.low = low;
+			row.close = close;
+		}
+		const auto unit = static_cast<double>(pow10_fixed(row.scale.price));
+		row.tick_count = tick_count;
+		row.quote_count = quote_count;
+		if (quote_count > 0) {
+			row.spread_min = spread_min;
+			row.spread_max = spread_max;
+			row.spread_mean = static_cast<double>(spread_sum) / static_cast<double>(quote_count) / unit;
+		}
+		accrue_mid(end_ms);
+		row.twap_ms = mid_ms;
+		if (mid_ms > 0) row.twap_mid = mid2_ms_sum / static_cast<double>(mid_ms) / (2.0 * unit);
+		else if (has_mid) row.twap_mid = static_cast<double>(last_mid2) / (2.0 * unit);
+
+		tick_count = 0;
+		quote_count = 0;
+		spread_sum = 0;
+		mid2_ms_sum = 0.0;
+		mid_ms = 0;
+		start_ms = end_ms;
+	}
+
+private:
+	void accrue_mid(std::int64_t until_ms) {
+		if (!has_mid) return;
+		const std::int64_t dt = until_ms - std::max(last_mid_ts_ms, start_ms);
+		if (dt <= 0) return;
+		mid2_ms_sum += static_cast<double>(last_mid2) * static_cast<double>(dt);
+		mid_ms += dt;
+	}
+};
+
+}
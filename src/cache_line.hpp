@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+
+namespace strategia {
+
+// Fixed instead of std::hardware_destructive_interference_size, which is not
+// ABI-stable across compilers and warns on GCC.
+inline constexpr std::size_t kCacheLineSize = 64;
+
+}
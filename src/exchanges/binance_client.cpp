@@ -1,98 +1,65 @@
 #include "binance_client.hpp"
 #include <nlohmann/json.hpp>
-#include <iostream>
 #include <cctype>
+#include <iostream>
+#include <stdexcept>
+#ifdef STRATEGIA_ENABLE_REST_BACKFILL
+#include <cpr/cpr.h>
+#endif
 
 using json = nlohmann::json;
 
 namespace strategia {
 
 static std::string to_lower(std::string s) { for (auto &c : s) c = static_cast<char>(::tolower(c)); return s; }
+static std::string to_upper(std::string s) { for (auto &c : s) c = static_cast<char>(::toupper(c)); return s; }
 
-BinanceClient::BinanceClient(std::string symbol)
-	: symbol_(std::move(symbol)) {}
+std::string BinanceProtocol::route_key(const std::string &symbol) { return to_upper(symbol); }
 
-BinanceClient::~BinanceClient() { stop(); }
-
-void BinanceClient::set_ticker_callback(TickerCallback cb) { on_ticker_ = std::move(cb); }
-void BinanceClient::set_orderbook_callback(OrderBookCallback cb) { on_orderbook_ = std::move(cb); }
-
-void BinanceClient::start() {
-	if (running_.exchange(true)) return;
-#ifdef STRATEGIA_ENABLE_WEBSOCKETS
-	ws_ = std::make_unique<ix::WebSocket>();
-	run_ws();
-#endif
+std::string BinanceProtocol::url(const std::vector<std::string> &symbols) {
+	// Diff-depth streams: the local books are kept in sync from these plus REST snapshots
+	std::string url = "wss://stream.binance.com:9443/stream?streams=";
+	for (std::size_t i = 0; i < symbols.size(); ++i) {
+		const std::string stream_symbol = to_lower(symbols[i]);
+		if (i > 0) url += '/';
+		url += stream_symbol + "@ticker/" + stream_symbol + "@depth@100ms";
+	}
+	return url;
 }
 
-void BinanceClient::stop() {
-	if (!running_.exchange(false)) return;
-#ifdef STRATEGIA_ENABLE_WEBSOCKETS
-	if (ws_) {
-		ws_->stop();
-		ws_.reset();
+bool BinanceProtocol::fetch_snapshot(const std::string &symbol, std::string &body) {
+	body.clear();
+#ifdef STRATEGIA_ENABLE_REST_BACKFILL
+	auto r = cpr::Get(cpr::Url{ "https://api.binance.com/api/v3/depth" }, cpr::Parameters{{"symbol", symbol}, {"limit", "1000"}});
+	if (r.status_code != 200) {
+		std::cerr << "Binance " << symbol << " depth snapshot error: HTTP " << r.status_code << "\n";
+		return false;
 	}
+	body = std::move(r.text);
+#else
+	std::cerr << "Binance " << symbol << " order book needs REST snapshots; build with ENABLE_REST_BACKFILL\n";
 #endif
+	return true;
 }
 
-void BinanceClient::run_ws() {
-#ifdef STRATEGIA_ENABLE_WEBSOCKETS
-	const std::string stream_symbol = to_lower(symbol_);
-	const std::string url = "wss://stream.binance.com:9443/stream?streams=" + stream_symbol + "@ticker/" + stream_symbol + "@depth5@100ms";
-	ws_->setUrl(url);
-
-	ws_->setOnMessageCallback([this](const ix::WebSocketMessagePtr &msg) {
-		if (msg->type == ix::WebSocketMessageType::Open) {
-			// Opened
-		} else if (msg->type == ix::WebSocketMessageType::Message) {
-			try {
-				auto j = json::parse(msg->str);
-				if (j.contains("stream") && j.contains("data")) {
-					auto d = j["data"];
-					if (d.contains("e") && d["e"].is_string()) {
-						std::string ev = d["e"].get<std::string>();
-						if (ev == "24hrTicker") {
-							TickerData t{};
-							t.exchange = "binance";
-							t.symbol = symbol_;
-							t.price = std::stod(d.value("c", "0"));
-							t.ts_ms = d.value("E", 0ll);
-							if (on_ticker_) on_ticker_(t);
-						} else if (ev == "depthUpdate") {
-							OrderBookData ob{};
-							ob.exchange = "binance";
-							ob.symbol = symbol_;
-							ob.ts_ms = d.value("E", 0ll);
-							ob.bids.clear();
-							ob.asks.clear();
-							if (d.contains("b")) {
-								for (auto &b : d["b"]) {
-									if (b.size() >= 2) {
-										ob.bids.push_back({ std::stod(b[0].get<std::string>()), std::stod(b[1].get<std::string>()) });
-									}
-								}
-							}
-							if (d.contains("a")) {
-								for (auto &a : d["a"]) {
-									if (a.size() >= 2) {
-										ob.asks.push_back({ std::stod(a[0].get<std::string>()), std::stod(a[1].get<std::string>()) });
-									}
-								}
-							}
-							if (on_orderbook_) on_orderbook_(ob);
-						}
-					}
-				}
-			} catch (const std::exception &e) {
-				std::cerr << "Binance WS parse error: " << e.what() << "\n";
+void BinanceProtocol::parse_snapshot(const std::string &body, FixedScale scale, std::int64_t &last_update_id,
+	std::vector<OrderBookLevel> &bids, std::vector<OrderBookLevel> &asks) {
+	auto read_side = [scale](const json &arr, std::vector<OrderBookLevel> &out) {
+		out.clear();
+		for (auto &l : arr) {
+			if (l.size() < 2) continue;
+			OrderBookLevel level;
+			if (!parse_fixed(l[0].get_ref<const std::string&>(), scale.price, level.price)
+				|| !parse_fixed(l[1].get_ref<const std::string&>(), scale.qty, level.amount)) {
+				throw std::runtime_error("level does not fit the fixed-point scale");
 			}
+			out.push_back(level);
 		}
-	});
-
-	ws_->start();
-#endif
+	};
+	auto j = json::parse(body);
+	last_update_id = j.at("lastUpdateId").get<std::int64_t>();
+	read_side(j.at("bids"), bids);
+	read_side(j.at("asks"), asks);
 }
 
 }
-
-
@@ -1,40 +1,42 @@
 #pragma once
 
-#include "exchange_client.hpp"
-#ifdef STRATEGIA_ENABLE_WEBSOCKETS
-#include <ixwebsocket/IXWebSocket.h>
-#endif
-#include <atomic>
-#include <thread>
-#include <memory>
+#include "feed_client.hpp"
+#include "book/book_sync.hpp"
+#include <string>
+#include <vector>
 
 namespace strategia {
 
-class BinanceClient final : public ExchangeClient {
-public:
-	explicit BinanceClient(std::string symbol);
-	~BinanceClient() override;
-
-	void start() override;
-	void stop() override;
-
-	void set_ticker_callback(TickerCallback cb) override;
-	void set_orderbook_callback(OrderBookCallback cb) override;
-
-private:
-	void run_ws();
-	void subscribe();
-
-private:
-	std::string symbol_;
-#ifdef STRATEGIA_ENABLE_WEBSOCKETS
-	std::unique_ptr<ix::WebSocket> ws_;
-#endif
-	std::atomic<bool> running_{false};
-	TickerCallback on_ticker_;
-	OrderBookCallback on_orderbook_;
+// Ticker and diff depth over combined-stream connections; the streams are
+// named in the URL, so nothing is sent after connecting. Binance allows at
+// most 1024 streams per connection; every symbol takes two. Books start from
+// REST depth snapshots.
+struct BinanceProtocol {
+	static constexpr Exchange kExchange = Exchange::Binance;
+	static constexpr const char *kName = "binance";
+	static constexpr const char *kLogName = "Binance";
+	static constexpr JournalSource kFrames = JournalSource::Binance;
+	static constexpr JournalSource kSnapshots = JournalSource::BinanceDepthSnapshot;
+	static constexpr std::size_t kStreamsPerInstrument = 2; // ticker + depth
+	static constexpr std::size_t kDefaultPerConnection = 200;
+	static constexpr bool kRestSnapshots = true;
+	using BookSync = BinanceBookSync;
+
+	// Frames carry the upper-case symbol in "s"
+	static std::string route_key(const std::string &symbol);
+	static std::string url(const std::vector<std::string> &symbols);
+	static std::string subscribe(const std::vector<std::string> &) { return {}; }
+	static void parse(const std::string &text, ParsedFrame &out) { parse_binance_frame(text, out); }
+
+	// False if the request failed and should be retried; an empty body
+	// means snapshots are unavailable in this build
+	static bool fetch_snapshot(const std::string &symbol, std::string &body);
+	// Throws on a malformed body or a value finer than scale
+	static void parse_snapshot(const std::string &body, FixedScale scale, std::int64_t &last_update_id,
+		std::vector<OrderBookLevel> &bids, std::vector<OrderBookLevel> &asks);
 };
 
-}
-
+template <typename Sink>
+using BinanceClient = FeedClient<BinanceProtocol, Sink>;
 
+}
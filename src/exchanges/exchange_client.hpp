@@ -1,44 +1,111 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
-#include <functional>
-#include <optional>
+#include <type_traits>
 #include <vector>
 #include <mutex>
 
+#include "instrument_registry.hpp"
+
 namespace strategia {
 
+class OrderBook;
+class FrameJournal;
+class LatencyMonitor;
+
+// One instrument a client streams, with the id its events are stamped with
+// and the fixed-point scale its prices and quantities are parsed at
+struct Subscription {
+	std::string symbol; // exchange-native
+	InstrumentId instrument = kInvalidInstrument;
+	FixedScale scale;
+};
+
+// Venues the clients connect to
+enum class Exchange : std::uint8_t { Binance, Okx };
+
+inline const char *to_string(Exchange e) {
+	switch (e) {
+	case Exchange::Binance: return "binance";
+	case Exchange::Okx: return "okx";
+	}
+	return "?";
+}
+
+// Feed events are plain values: no strings or heap buffers, so emitting one
+// never allocates and they copy with memcpy. The symbol is looked up from
+// the instrument id when needed (InstrumentRegistry), and so is the
+// fixed-point scale of prices and amounts (fixed_point.hpp).
 struct TickerData {
-	std::string exchange; // "binance" or "okx"
-	std::string symbol;   // e.g. "BTCUSDT"
-	double price = 0.0;
+	InstrumentId instrument = kInvalidInstrument;
+	Exchange exchange = Exchange::Binance;
+	std::int64_t price = 0;
 	std::int64_t ts_ms = 0; // exchange timestamp in ms if available
+	std::int64_t recv_ns = 0;   // local unix ns at socket receive; 0 if not from a socket
+	std::int64_t parsed_ns = 0; // local unix ns once parsed
 };
 
 struct OrderBookLevel {
-	double price = 0.0;
-	double amount = 0.0;
+	std::int64_t price = 0;
+	std::int64_t amount = 0;
+};
+
+// Number of best levels copied into OrderBookData::bids/asks
+inline constexpr std::size_t kBookTopLevels = 5;
+
+// Up to kBookTopLevels levels stored inline, best first
+class BookLevels {
+public:
+	std::size_t size() const { return count_; }
+	bool empty() const { return count_ == 0; }
+	static constexpr std::size_t capacity() { return kBookTopLevels; }
+
+	const OrderBookLevel &operator[](std::size_t i) const { return levels_[i]; }
+	OrderBookLevel &operator[](std::size_t i) { return levels_[i]; }
+	const OrderBookLevel &front() const { return levels_[0]; }
+	OrderBookLevel &front() { return levels_[0]; }
+	const OrderBookLevel *begin() const { return levels_; }
+	const OrderBookLevel *end() const { return levels_ + count_; }
+
+	void clear() { count_ = 0; }
+	// Levels beyond capacity() are dropped
+	void push_back(const OrderBookLevel &l) {
+		if (count_ < kBookTopLevels) levels_[count_++] = l;
+	}
+
+private:
+	OrderBookLevel levels_[kBookTopLevels];
+	std::uint32_t count_ = 0;
 };
 
 struct OrderBookData {
-	std::string exchange;
-	std::string symbol;
-	std::vector<OrderBookLevel> bids; // sorted desc by price
-	std::vector<OrderBookLevel> asks; // sorted asc by price
+	InstrumentId instrument = kInvalidInstrument;
+	Exchange exchange = Exchange::Binance;
+	BookLevels bids; // sorted desc by price
+	BookLevels asks; // sorted asc by price
 	std::int64_t ts_ms = 0;
+	std::int64_t recv_ns = 0;   // of the frame that produced this book state; 0 for REST snapshots
+	std::int64_t parsed_ns = 0; // once that frame was parsed
+	const OrderBook *book = nullptr; // full local book; valid only during the callback
 };
 
-using TickerCallback = std::function<void(const TickerData&)>;
-using OrderBookCallback = std::function<void(const OrderBookData&)>;
+static_assert(std::is_trivially_copyable_v<TickerData>);
+static_assert(std::is_trivially_copyable_v<OrderBookData>);
 
+// Control side of a feed client, for code that wires exchanges up from
+// configuration (make_exchange_client). Events never pass through it: each
+// FeedClient delivers them to its Sink directly.
 class ExchangeClient {
 public:
 	virtual ~ExchangeClient() = default;
 	virtual void start() = 0;
 	virtual void stop() = 0;
 
-	virtual void set_ticker_callback(TickerCallback cb) = 0;
-	virtual void set_orderbook_callback(OrderBookCallback cb) = 0;
+	// Records every raw frame when set; call before start()
+	virtual void set_journal(FrameJournal *journal) = 0;
+	// Records exchange-to-receive and receive-to-parse latencies when set; call before start()
+	virtual void set_latency_monitor(LatencyMonitor *monitor) = 0;
 };
 
 }
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "binance_client.hpp"
+#include "okx_client.hpp"
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace strategia {
+
+// Picks the adapter for an exchange chosen at run time. The client is then
+// driven through ExchangeClient, while its events still reach Sink without
+// type erasure. per_connection is in the protocol's unit (0: its default).
+template <typename Sink>
+std::unique_ptr<ExchangeClient> make_exchange_client(Exchange exchange, std::vector<Subscription> subs,
+	Sink sink, std::size_t per_connection = 0) {
+	switch (exchange) {
+	case Exchange::Binance:
+		return std::make_unique<BinanceClient<Sink>>(std::move(subs), std::move(sink),
+			per_connection ? per_connection : BinanceProtocol::kDefaultPerConnection);
+	case Exchange::Okx:
+		return std::make_unique<OkxClient<Sink>>(std::move(subs), std::move(sink),
+			per_connection ? per_connection : OkxProtocol::kDefaultPerConnection);
+	}
+	throw std::invalid_argument("unknown exchange");
+}
+
+}
@@ -0,0 +1,366 @@
+#pragma once
+
+#include "exchange_client.hpp"
+#include "feed_metrics.hpp"
+#include "frame_parser.hpp"
+#include "symbol_router.hpp"
+#include "time_utils.hpp"
+#include "book/book_sync.hpp"
+#include "journal/frame_journal.hpp"
+#include "metrics/latency_monitor.hpp"
+#ifdef STRATEGIA_ENABLE_WEBSOCKETS
+#include <ixwebsocket/IXWebSocket.h>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace strategia {
+
+// Websocket feed of one exchange, assembled at compile time from a Protocol
+// (endpoint, subscriptions, frame parser, book sync) and a Sink receiving
+// the events. The receive path, parse -> route -> book -> sink, has no
+// virtual or type-erased calls, so the compiler can inline it end to end;
+// ExchangeClient only covers the control side.
+//
+// Protocol provides:
+//   kExchange, kName ("binance"), kLogName ("Binance"), kFrames (JournalSource)
+//   kStreamsPerInstrument: units of the per-connection limit one instrument takes
+//   kDefaultPerConnection
+//   kRestSnapshots: books start from REST snapshots (BookSync::on_snapshot),
+//     fetched on a client thread; otherwise a Resync resubscribes the book
+//   BookSync, with on_update(const BookUpdate&) and book()
+//   route_key(symbol): the symbol as frames carry it
+//   url(symbols), subscribe(symbols): per connection; "" sends nothing
+//   parse(text, ParsedFrame&), leaving prices and amounts as text
+//   with kRestSnapshots: kSnapshots (JournalSource), fetch_snapshot(symbol, body)
+//     and parse_snapshot(body, scale, last_update_id, bids, asks)
+//   without: resubscribe_book(symbol), the messages to send on Resync
+//
+// Sink provides on_ticker(const TickerData&) and on_orderbook(const OrderBookData&),
+// called from every receive thread (and the snapshot thread) concurrently.
+template <typename Protocol, typename Sink>
+class FeedClient final : public ExchangeClient {
+public:
+	FeedClient(std::vector<Subscription> subs, Sink sink, std::size_t per_connection = Protocol::kDefaultPerConnection);
+	~FeedClient() override { stop(); }
+
+	FeedClient(const FeedClient&) = delete;
+	FeedClient &operator=(const FeedClient&) = delete;
+
+	void start() override;
+	void stop() override;
+	void set_journal(FrameJournal *journal) override { journal_ = journal; }
+	void set_latency_monitor(LatencyMonitor *monitor) override;
+
+	Sink &sink() { return sink_; }
+
+	// Replay of journaled input on a client that was never started; not thread-safe
+	void replay_frame(const std::string &text);
+	// REST snapshot record ("<symbol>\n<body>"); REST-snapshot protocols only
+	void replay_snapshot(std::string_view payload);
+
+private:
+	// Per-instrument state. Touched by the owning connection's thread, and
+	// under book_mu by the snapshot thread when the protocol has one.
+	struct Market {
+		std::string symbol;
+		InstrumentId instrument = kInvalidInstrument;
+		FixedScale scale;
+		std::uint32_t connection = 0;
+		std::mutex book_mu;
+		typename Protocol::BookSync book_sync;
+		OrderBookData book_out;
+	};
+
+	struct Connection {
+		std::vector<std::uint32_t> markets;
+#ifdef STRATEGIA_ENABLE_WEBSOCKETS
+		std::unique_ptr<ix::WebSocket> ws;
+#endif
+		ParsedFrame frame; // receive-thread scratch
+		FrameJournal::Channel *journal = nullptr;
+		bool opened = false; // receive thread only
+	};
+
+	void run_ws(Connection &conn);
+	void on_frame(Connection &conn, const std::string &text, std::int64_t recv_ns);
+	void on_book_update(std::uint32_t market, const BookUpdate &u, std::int64_t recv_ns, std::int64_t parsed_ns);
+	void on_sync_status(std::uint32_t market, BookSyncStatus status); // requires book_mu with REST snapshots
+	void resubscribe_book(Market &m);
+
+	void request_snapshot(std::uint32_t market);
+	void snapshot_loop(); // runs on snapshot_thread_
+	bool load_snapshot(std::uint32_t market); // false: fetch failed, retry later
+	bool apply_snapshot(std::uint32_t market, const std::string &body);
+
+	std::vector<std::unique_ptr<Market>> markets_;
+	std::vector<std::unique_ptr<Connection>> connections_;
+	SymbolRouter router_; // route_key(symbol) -> index into markets_
+	std::atomic<bool> running_{false};
+	Sink sink_;
+	FrameJournal *journal_ = nullptr;
+	LatencyMonitor *latency_ = nullptr;
+	std::size_t latency_exchange_ = 0;
+	FeedMetrics metrics_{Protocol::kName};
+
+	// REST snapshots are fetched one at a time off the receive threads
+	FrameJournal::Channel *snapshot_journal_ = nullptr; // written by snapshot_thread_
+	std::mutex snapshot_mu_;
+	std::condition_variable snapshot_cv_;
+	std::deque<std::uint32_t> snapshot_queue_;
+	std::thread snapshot_thread_;
+};
+
+template <typename Protocol, typename Sink>
+FeedClient<Protocol, Sink>::FeedClient(std::vector<Subscription> subs, Sink sink, std::size_t per_connection)
+	: sink_(std::move(sink)) {
+	const std::size_t per_conn = std::max<std::size_t>(per_connection / Protocol::kStreamsPerInstrument, 1);
+	for (auto &sub : subs) {
+		const auto idx = static_cast<std::uint32_t>(markets_.size());
+		if (connections_.empty() || connections_.back()->markets.size() == per_conn) {
+			connections_.push_back(std::make_unique<Connection>());
+			connections_.back()->frame.ticker.exchange = Protocol::kExchange;
+		}
+		connections_.back()->markets.push_back(idx);
+
+		auto m = std::make_unique<Market>();
+		m->symbol = std::move(sub.symbol);
+		m->instrument = sub.instrument;
+		m->scale = sub.scale;
+		m->connection = static_cast<std::uint32_t>(connections_.size() - 1);
+		m->book_out.instrument = m->instrument;
+		m->book_out.exchange = Protocol::kExchange;
+		router_.add(Protocol::route_key(m->symbol), idx);
+		markets_.push_back(std::move(m));
+	}
+}
+
+template <typename Protocol, typename Sink>
+void FeedClient<Protocol, Sink>::set_latency_monitor(LatencyMonitor *monitor) {
+	latency_ = monitor;
+	if (latency_) latency_exchange_ = latency_->add_exchange(Protocol::kName);
+}
+
+template <typename Protocol, typename Sink>
+void FeedClient<Protocol, Sink>::start() {
+	if (running_.exchange(true)) return;
+#ifdef STRATEGIA_ENABLE_WEBSOCKETS
+	if constexpr (Protocol::kRestSnapshots) {
+		if (journal_ && !snapshot_journal_) snapshot_journal_ = journal_->open_channel(Protocol::kSnapshots);
+		snapshot_thread_ = std::thread([this] { snapshot_loop(); });
+	}
+	for (auto &conn : connections_) {
+		if (journal_ && !conn->journal) conn->journal = journal_->open_channel(Protocol::kFrames);
+		conn->ws = std::make_unique<ix::WebSocket>();
+		run_ws(*conn);
+	}
+#endif
+}
+
+template <typename Protocol, typename Sink>
+void FeedClient<Protocol, Sink>::stop() {
+	if (!running_.exchange(false)) return;
+#ifdef STRATEGIA_ENABLE_WEBSOCKETS
+	for (auto &conn : connections_) {
+		if (conn->ws) {
+			conn->ws->stop();
+			conn->ws.reset();
+		}
+	}
+#endif
+	{
+		std::lock_guard<std::mutex> lk(snapshot_mu_);
+	}
+	snapshot_cv_.notify_all();
+	if (snapshot_thread_.joinable()) snapshot_thread_.join();
+}
+
+template <typename Protocol, typename Sink>
+void FeedClient<Protocol, Sink>::on_frame(Connection &conn, const std::string &text, std::int64_t recv_ns) {
+	ParsedFrame &frame = conn.frame;
+	Protocol::parse(text, frame);
+	if (frame.kind == FrameKind::Ignored) {
+		metrics_.ignored.inc();
+		return;
+	}
+	const std::int64_t parsed_ns = recv_ns ? current_unix_nanos() : 0;
+	const std::uint32_t market = router_.find(frame.symbol);
+	if (market == SymbolRouter::kNoSlot) {
+		metrics_.ignored.inc();
+		return;
+	}
+	if (!scale_frame(frame, markets_[market]->scale)) {
+		throw std::runtime_error(markets_[market]->symbol + " value does not fit its fixed-point scale");
+	}
+	if (frame.kind == FrameKind::Ticker) {
+		metrics_.tickers.inc();
+		if (latency_) record_frame_latency(*latency_, latency_exchange_, FeedChannel::Ticker, frame.ticker.ts_ms, recv_ns, parsed_ns);
+		frame.ticker.instrument = markets_[market]->instrument;
+		frame.ticker.recv_ns = recv_ns;
+		frame.ticker.parsed_ns = parsed_ns;
+		sink_.on_ticker(frame.ticker);
+	} else {
+		metrics_.book_updates.inc();
+		if (latency_) record_frame_latency(*latency_, latency_exchange_, FeedChannel::Book, frame.update.ts_ms, recv_ns, parsed_ns);
+		on_book_update(market, frame.update, recv_ns, parsed_ns);
+	}
+}
+
+template <typename Protocol, typename Sink>
+void FeedClient<Protocol, Sink>::on_book_update(std::uint32_t market, const BookUpdate &u,
+	std::int64_t recv_ns, std::int64_t parsed_ns) {
+	Market &m = *markets_[market];
+	std::unique_lock<std::mutex> lk(m.book_mu, std::defer_lock);
+	if constexpr (Protocol::kRestSnapshots) lk.lock();
+	m.book_out.ts_ms = u.ts_ms;
+	m.book_out.recv_ns = recv_ns;
+	m.book_out.parsed_ns = parsed_ns;
+	const BookSyncStatus status = m.book_sync.on_update(u);
+	if (status == BookSyncStatus::NeedSnapshot || status == BookSyncStatus::Resync) metrics_.resyncs.inc();
+	on_sync_status(market, status);
+}
+
+template <typename Protocol, typename Sink>
+void FeedClient<Protocol, Sink>::on_sync_status(std::uint32_t market, BookSyncStatus status) {
+	Market &m = *markets_[market];
+	switch (status) {
+	case BookSyncStatus::Applied:
+		fill_top_levels(m.book_sync.book(), kBookTopLevels, m.book_out);
+		sink_.on_orderbook(m.book_out);
+		break;
+	case BookSyncStatus::NeedSnapshot:
+		if constexpr (Protocol::kRestSnapshots) request_snapshot(market);
+		break;
+	case BookSyncStatus::Resync:
+		if constexpr (!Protocol::kRestSnapshots) resubscribe_book(m);
+		break;
+	default:
+		break;
+	}
+}
+
+template <typename Protocol, typename Sink>
+void FeedClient<Protocol, Sink>::resubscribe_book(Market &m) {
+	std::cerr << Protocol::kLogName << " " << m.symbol << " book out of sync, resubscribing\n";
+#ifdef STRATEGIA_ENABLE_WEBSOCKETS
+	auto &ws = connections_[m.connection]->ws;
+	if (!ws) return; // replay
+	for (const auto &message : Protocol::resubscribe_book(m.symbol)) ws->send(message);
+#endif
+}
+
+template <typename Protocol, typename Sink>
+void FeedClient<Protocol, Sink>::request_snapshot(std::uint32_t market) {
+	if (!running_.load()) return; // replay: snapshots come from the journal
+	{
+		std::lock_guard<std::mutex> lk(snapshot_mu_);
+		snapshot_queue_.push_back(market);
+	}
+	snapshot_cv_.notify_one();
+}
+
+template <typename Protocol, typename Sink>
+void FeedClient<Protocol, Sink>::snapshot_loop() {
+	while (true) {
+		std::uint32_t market = 0;
+		{
+			std::unique_lock<std::mutex> lk(snapshot_mu_);
+			snapshot_cv_.wait(lk, [this] { return !running_.load() || !snapshot_queue_.empty(); });
+			if (!running_.load()) return;
+			market = snapshot_queue_.front();
+			snapshot_queue_.pop_front();
+		}
+		if (!load_snapshot(market)) {
+			std::this_thread::sleep_for(std::chrono::seconds(1));
+			request_snapshot(market);
+		}
+	}
+}
+
+template <typename Protocol, typename Sink>
+bool FeedClient<Protocol, Sink>::load_snapshot(std::uint32_t market) {
+	const Market &m = *markets_[market];
+	std::string body;
+	if (!Protocol::fetch_snapshot(m.symbol, body)) return false;
+	if (body.empty()) return true;
+	if (snapshot_journal_) snapshot_journal_->append(m.symbol + '\n' + body, current_unix_nanos());
+	return apply_snapshot(market, body);
+}
+
+template <typename Protocol, typename Sink>
+bool FeedClient<Protocol, Sink>::apply_snapshot(std::uint32_t market, const std::string &body) {
+	Market &m = *markets_[market];
+	std::vector<OrderBookLevel> bids, asks;
+	std::int64_t last_update_id = 0;
+	try {
+		Protocol::parse_snapshot(body, m.scale, last_update_id, bids, asks);
+	} catch (const std::exception &e) {
+		std::cerr << Protocol::kLogName << " " << m.symbol << " depth snapshot error: " << e.what() << "\n";
+		return false;
+	}
+	std::lock_guard<std::mutex> lk(m.book_mu);
+	m.book_out.recv_ns = 0;
+	m.book_out.parsed_ns = 0;
+	on_sync_status(market, m.book_sync.on_snapshot(last_update_id, bids, asks));
+	return true;
+}
+
+template <typename Protocol, typename Sink>
+void FeedClient<Protocol, Sink>::replay_frame(const std::string &text) {
+	if (!connections_.empty()) on_frame(*connections_.front(), text, 0);
+}
+
+template <typename Protocol, typename Sink>
+void FeedClient<Protocol, Sink>::replay_snapshot(std::string_view payload) {
+	static_assert(Protocol::kRestSnapshots, "the protocol has no REST snapshots");
+	const auto nl = payload.find('\n');
+	if (nl == std::string_view::npos) return;
+	const std::uint32_t market = router_.find(Protocol::route_key(std::string(payload.substr(0, nl))));
+	if (market == SymbolRouter::kNoSlot) return;
+	apply_snapshot(market, std::string(payload.substr(nl + 1)));
+}
+
+template <typename Protocol, typename Sink>
+void FeedClient<Protocol, Sink>::run_ws(Connection &conn) {
+#ifdef STRATEGIA_ENABLE_WEBSOCKETS
+	std::vector<std::string> symbols;
+	for (auto idx : conn.markets) symbols.push_back(markets_[idx]->symbol);
+	conn.ws->setUrl(Protocol::url(symbols));
+
+	conn.ws->setOnMessageCallback([this, &conn, subscribe = Protocol::subscribe(symbols)](const ix::WebSocketMessagePtr &msg) {
+		if (msg->type == ix::WebSocketMessageType::Open) {
+			if (conn.opened) metrics_.reconnects.inc();
+			conn.opened = true;
+			if (!subscribe.empty()) conn.ws->send(subscribe);
+		} else if (msg->type == ix::WebSocketMessageType::Close) {
+			metrics_.disconnects.inc();
+		} else if (msg->type == ix::WebSocketMessageType::Error) {
+			metrics_.ws_errors.inc();
+		} else if (msg->type == ix::WebSocketMessageType::Message) {
+			const std::int64_t recv_ns = current_unix_nanos();
+			if (conn.journal) conn.journal->append(msg->str, recv_ns);
+			try {
+				on_frame(conn, msg->str, recv_ns);
+			} catch (const std::exception &e) {
+				metrics_.parse_errors.inc();
+				std::cerr << Protocol::kLogName << " WS parse error: " << e.what() << "\n";
+			}
+		}
+	});
+
+	conn.ws->start();
+#else
+	(void)conn;
+#endif
+}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "metrics/metrics_registry.hpp"
+#include <string>
+
+namespace strategia {
+
+// Counters one exchange client reports to the global registry
+struct FeedMetrics {
+	explicit FeedMetrics(const std::string &exchange)
+		: tickers(frames(exchange, "ticker"))
+		, book_updates(frames(exchange, "book"))
+		, ignored(frames(exchange, "ignored"))
+		, parse_errors(MetricsRegistry::global().counter("strategia_ws_parse_errors_total",
+			"Frames that failed to parse", {{"exchange", exchange}}))
+		, reconnects(MetricsRegistry::global().counter("strategia_ws_reconnects_total",
+			"Websocket connections re-established after the first open", {{"exchange", exchange}}))
+		, disconnects(MetricsRegistry::global().counter("strategia_ws_disconnects_total",
+			"Websocket connections closed by either side", {{"exchange", exchange}}))
+		, ws_errors(MetricsRegistry::global().counter("strategia_ws_errors_total",
+			"Websocket connect or transport errors", {{"exchange", exchange}}))
+		, resyncs(MetricsRegistry::global().counter("strategia_book_resyncs_total",
+			"Order books found out of sequence and rebuilt", {{"exchange", exchange}})) {}
+
+	Counter &tickers;
+	Counter &book_updates;
+	Counter &ignored; // subscription acks, pongs, unknown streams
+	Counter &parse_errors;
+	Counter &reconnects;
+	Counter &disconnects;
+	Counter &ws_errors;
+	Counter &resyncs;
+
+private:
+	static Counter &frames(const std::string &exchange, const char *kind) {
+		return MetricsRegistry::global().counter("strategia_ws_frames_total",
+			"Websocket frames received, by kind", {{"exchange", exchange}, {"kind", kind}});
+	}
+};
+
+}
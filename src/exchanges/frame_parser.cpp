@@ -0,0 +1,225 @@
+#include "frame_parser.hpp"
+#include "json_scan.hpp"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace strategia {
+
+namespace {
+
+// [["price","amount",...], ...]; entries with fewer than two fields are skipped
+bool scan_levels(std::string_view arr, std::vector<LevelUpdate> &out) {
+	out.clear();
+	return json_scan::for_each_element(arr, [&](std::string_view level) {
+		std::string_view fields[2];
+		int n = 0;
+		const bool ok = json_scan::for_each_element(level, [&](std::string_view v) {
+			if (n < 2) fields[n] = v;
+			++n;
+			return true;
+		});
+		if (!ok) return false;
+		if (n < 2) return true;
+		LevelUpdate l;
+		if (!json_scan::string_value(fields[0], l.price_text) || !json_scan::string_value(fields[1], l.amount_text)) return false;
+		out.push_back(l);
+		return true;
+	});
+}
+
+std::size_t json_levels_text_size(const json &arr) {
+	std::size_t n = 0;
+	for (auto &l : arr) {
+		if (l.size() >= 2) n += l[0].get_ref<const std::string&>().size() + l[1].get_ref<const std::string&>().size();
+	}
+	return n;
+}
+
+// Level text is copied into text_buf, which the caller has reserved up front so views stay valid
+void json_levels(const json &arr, std::vector<LevelUpdate> &out, std::string &text_buf) {
+	out.clear();
+	auto keep = [&](const std::string &s) {
+		const std::size_t at = text_buf.size();
+		text_buf += s;
+		return std::string_view(text_buf).substr(at, s.size());
+	};
+	for (auto &l : arr) {
+		if (l.size() < 2) continue;
+		const auto &px = l[0].get_ref<const std::string&>();
+		const auto &sz = l[1].get_ref<const std::string&>();
+		out.push_back({ 0, 0, keep(px), keep(sz) });
+	}
+}
+
+void json_book(const json &d, const char *bids_key, const char *asks_key, ParsedFrame &out) {
+	out.text_buf.clear();
+	std::size_t text = 0;
+	if (d.contains(bids_key)) text += json_levels_text_size(d[bids_key]);
+	if (d.contains(asks_key)) text += json_levels_text_size(d[asks_key]);
+	out.text_buf.reserve(text);
+	out.update.bids.clear();
+	out.update.asks.clear();
+	if (d.contains(bids_key)) json_levels(d[bids_key], out.update.bids, out.text_buf);
+	if (d.contains(asks_key)) json_levels(d[asks_key], out.update.asks, out.text_buf);
+}
+
+void set_symbol(ParsedFrame &out, std::string symbol) {
+	out.symbol_buf = std::move(symbol);
+	out.symbol = out.symbol_buf;
+}
+
+void set_ticker_price(ParsedFrame &out, std::string text) {
+	out.text_buf = std::move(text);
+	out.ticker_price = out.text_buf;
+}
+
+bool scale_levels(std::vector<LevelUpdate> &levels, FixedScale scale) {
+	for (auto &l : levels) {
+		if (!parse_fixed(l.price_text, scale.price, l.price) || !parse_fixed(l.amount_text, scale.qty, l.amount)) return false;
+	}
+	return true;
+}
+
+}
+
+bool scale_frame(ParsedFrame &frame, FixedScale scale) {
+	if (frame.kind == FrameKind::Ticker) return parse_fixed(frame.ticker_price, scale.price, frame.ticker.price);
+	if (frame.kind == FrameKind::BookUpdate) return scale_levels(frame.update.bids, scale) && scale_levels(frame.update.asks, scale);
+	return true;
+}
+
+bool parse_binance_frame_fast(std::string_view frame, ParsedFrame &out) {
+	out.kind = FrameKind::Ignored;
+	out.symbol = {};
+	static constexpr std::string_view top_keys[] = {"stream", "data"};
+	std::string_view top[2];
+	if (!json_scan::object_fields(frame, top_keys, top) || top[0].empty() || top[1].empty()) return false;
+
+	static constexpr std::string_view data_keys[] = {"e", "E", "s", "c", "b", "a", "U", "u"};
+	std::string_view d[8];
+	if (!json_scan::object_fields(top[1], data_keys, d)) return false;
+	std::string_view ev;
+	if (!json_scan::string_value(d[0], ev)) return false;
+	if (!d[2].empty() && !json_scan::string_value(d[2], out.symbol)) return false;
+
+	if (ev == "24hrTicker") {
+		if (d[1].empty() || d[3].empty()) return false;
+		if (!json_scan::number_value(d[1], out.ticker.ts_ms) || !json_scan::string_value(d[3], out.ticker_price)) return false;
+		out.kind = FrameKind::Ticker;
+	} else if (ev == "depthUpdate") {
+		BookUpdate &u = out.update;
+		if (d[1].empty() || d[6].empty() || d[7].empty()) return false;
+		if (!json_scan::number_value(d[1], u.ts_ms)) return false;
+		if (!json_scan::number_value(d[6], u.first_update_id) || !json_scan::number_value(d[7], u.last_update_id)) return false;
+		u.snapshot = false;
+		u.has_checksum = false;
+		u.bids.clear();
+		u.asks.clear();
+		if (!d[4].empty() && !scan_levels(d[4], u.bids)) return false;
+		if (!d[5].empty() && !scan_levels(d[5], u.asks)) return false;
+		out.kind = FrameKind::BookUpdate;
+	}
+	return true;
+}
+
+void parse_binance_frame_json(const std::string &frame, ParsedFrame &out) {
+	out.kind = FrameKind::Ignored;
+	out.symbol = {};
+	auto j = json::parse(frame);
+	if (!j.contains("stream") || !j.contains("data")) return;
+	const auto &d = j["data"];
+	if (!d.contains("e") || !d["e"].is_string()) return;
+	if (d.contains("s") && d["s"].is_string()) set_symbol(out, d["s"].get<std::string>());
+	const std::string ev = d["e"].get<std::string>();
+	if (ev == "24hrTicker") {
+		set_ticker_price(out, d.value("c", "0"));
+		out.ticker.ts_ms = d.value("E", 0ll);
+		out.kind = FrameKind::Ticker;
+	} else if (ev == "depthUpdate") {
+		BookUpdate &u = out.update;
+		u.snapshot = false;
+		u.has_checksum = false;
+		u.ts_ms = d.value("E", 0ll);
+		u.first_update_id = d.value("U", 0ll);
+		u.last_update_id = d.value("u", 0ll);
+		json_book(d, "b", "a", out);
+		out.kind = FrameKind::BookUpdate;
+	}
+}
+
+bool parse_okx_frame_fast(std::string_view frame, ParsedFrame &out) {
+	out.kind = FrameKind::Ignored;
+	out.symbol = {};
+	static constexpr std::string_view top_keys[] = {"event", "arg", "data", "action"};
+	std::string_view top[4];
+	if (!json_scan::object_fields(frame, top_keys, top)) return false;
+	if (!top[0].empty()) return true; // subscription acks
+	if (top[1].empty() || top[2].empty()) return false;
+
+	static constexpr std::string_view arg_keys[] = {"channel", "instId"};
+	std::string_view arg[2];
+	std::string_view channel;
+	if (!json_scan::object_fields(top[1], arg_keys, arg) || !json_scan::string_value(arg[0], channel)) return false;
+	if (!arg[1].empty() && !json_scan::string_value(arg[1], out.symbol)) return false;
+	if (channel != "tickers" && channel != "books") return true;
+
+	// data is an array; only the first entry is used
+	std::string_view first;
+	if (!json_scan::for_each_element(top[2], [&](std::string_view e) { if (first.empty()) first = e; return true; })) return false;
+	if (first.empty()) return true;
+
+	static constexpr std::string_view data_keys[] = {"ts", "last", "bids", "asks", "checksum", "seqId", "prevSeqId"};
+	std::string_view d[7];
+	if (!json_scan::object_fields(first, data_keys, d)) return false;
+	if (d[0].empty() || d[0].front() != '"') return false;
+	if (channel == "tickers") {
+		if (d[1].empty()) return false;
+		if (!json_scan::number_value(d[0], out.ticker.ts_ms) || !json_scan::string_value(d[1], out.ticker_price)) return false;
+		out.kind = FrameKind::Ticker;
+	} else {
+		BookUpdate &u = out.update;
+		std::string_view action;
+		std::int64_t checksum = 0;
+		if (!json_scan::string_value(top[3], action)) return false;
+		if (d[2].empty() || d[3].empty() || d[4].empty() || d[5].empty() || d[6].empty()) return false;
+		if (!json_scan::number_value(d[0], u.ts_ms) || !json_scan::number_value(d[4], checksum)) return false;
+		if (!json_scan::number_value(d[5], u.last_update_id) || !json_scan::number_value(d[6], u.first_update_id)) return false;
+		if (!scan_levels(d[2], u.bids) || !scan_levels(d[3], u.asks)) return false;
+		u.snapshot = action == "snapshot";
+		u.has_checksum = true;
+		u.checksum = static_cast<std::int32_t>(checksum);
+		out.kind = FrameKind::BookUpdate;
+	}
+	return true;
+}
+
+void parse_okx_frame_json(const std::string &frame, ParsedFrame &out) {
+	out.kind = FrameKind::Ignored;
+	out.symbol = {};
+	auto j = json::parse(frame);
+	if (j.contains("event")) return; // subscription acks
+	if (!j.contains("arg") || !j.contains("data")) return;
+	const auto &arg = j["arg"];
+	const std::string channel = arg.value("channel", "");
+	if (arg.contains("instId") && arg["instId"].is_string()) set_symbol(out, arg["instId"].get<std::string>());
+	if (j["data"].empty()) return;
+	const auto &d = j["data"][0];
+	if (channel == "tickers") {
+		set_ticker_price(out, d.value("last", "0"));
+		out.ticker.ts_ms = std::stoll(d.value("ts", "0"));
+		out.kind = FrameKind::Ticker;
+	} else if (channel == "books") {
+		BookUpdate &u = out.update;
+		u.snapshot = j.value("action", "") == "snapshot";
+		u.ts_ms = std::stoll(d.value("ts", "0"));
+		u.has_checksum = d.contains("checksum");
+		u.checksum = static_cast<std::int32_t>(d.value("checksum", 0ll));
+		u.last_update_id = d.value("seqId", 0ll);
+		u.first_update_id = d.value("prevSeqId", 0ll);
+		json_book(d, "bids", "asks", out);
+		out.kind = FrameKind::BookUpdate;
+	}
+}
+
+}
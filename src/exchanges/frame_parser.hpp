@@ -0,0 +1,70 @@
+#pragma once
+
+#include "exchange_client.hpp"
+#include <string>
+#include <string_view>
+
+namespace strategia {
+
+enum class FrameKind { Ignored, Ticker, BookUpdate };
+
+// One changed level of a depth push; amount == 0 removes the level.
+// Parsers fill the text only; scale_frame() converts it to fixed point once
+// the instrument, and so the scale, is known. The text stays for exchanges
+// whose checksums are defined over it.
+struct LevelUpdate {
+	std::int64_t price = 0;
+	std::int64_t amount = 0;
+	std::string_view price_text;
+	std::string_view amount_text;
+};
+
+struct BookUpdate {
+	bool snapshot = false;             // OKX "action":"snapshot"; Binance diffs are never snapshots
+	std::int64_t first_update_id = 0;  // Binance U / OKX prevSeqId
+	std::int64_t last_update_id = 0;   // Binance u / OKX seqId
+	bool has_checksum = false;
+	std::int32_t checksum = 0;         // OKX only
+	std::int64_t ts_ms = 0;
+	std::vector<LevelUpdate> bids;
+	std::vector<LevelUpdate> asks;
+};
+
+// Output of one WebSocket frame. Owned by the receive thread and reused across
+// frames, so the level vectors keep their capacity and ticker.exchange, which
+// parsers never touch, is set only once.
+// Views are valid until the next parse or until the frame buffer goes away.
+struct ParsedFrame {
+	FrameKind kind = FrameKind::Ignored;
+	TickerData ticker;
+	std::string_view ticker_price; // text of ticker.price, see scale_frame()
+	BookUpdate update;
+	std::string_view symbol; // as sent by the exchange; points into the frame or symbol_buf
+	std::string symbol_buf;  // backing storage for symbol on the nlohmann path
+	std::string text_buf;    // backing storage for price and level text on the nlohmann path
+};
+
+// Fast path: scans the frame in place and extracts only the fields we use.
+// Returns false when the frame is not one of the expected shapes; out is then unspecified.
+bool parse_binance_frame_fast(std::string_view frame, ParsedFrame &out);
+bool parse_okx_frame_fast(std::string_view frame, ParsedFrame &out);
+
+// Reference path on a full nlohmann::json DOM. Throws on malformed frames.
+void parse_binance_frame_json(const std::string &frame, ParsedFrame &out);
+void parse_okx_frame_json(const std::string &frame, ParsedFrame &out);
+
+// Sets ticker.price or the level prices and amounts from their text at the
+// instrument's scale. False when a value is not a plain decimal, has more
+// decimals than the scale or does not fit; the frame must be dropped then.
+bool scale_frame(ParsedFrame &frame, FixedScale scale);
+
+// Fast path first, nlohmann as the fallback.
+inline void parse_binance_frame(const std::string &frame, ParsedFrame &out) {
+	if (!parse_binance_frame_fast(frame, out)) parse_binance_frame_json(frame, out);
+}
+
+inline void parse_okx_frame(const std::string &frame, ParsedFrame &out) {
+	if (!parse_okx_frame_fast(frame, out)) parse_okx_frame_json(frame, out);
+}
+
+}
@@ -0,0 +1,182 @@
+#include "json_scan.hpp"
+
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace strategia::json_scan {
+
+namespace {
+
+// First position in [p, end) holding '"' or '\\'.
+const char *find_quote_or_escape(const char *p, const char *end) {
+#if defined(__SSE2__)
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i bslash = _mm_set1_epi8('\\');
+	while (end - p >= 16) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		const int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, bslash)));
+		if (mask) return p + __builtin_ctz(static_cast<unsigned>(mask));
+		p += 16;
+	}
+#endif
+	while (p < end && *p != '"' && *p != '\\') ++p;
+	return p;
+}
+
+// First position in [p, end) holding a quote or a bracket.
+const char *find_structural(const char *p, const char *end) {
+#if defined(__SSE2__)
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i lbrace = _mm_set1_epi8('{');
+	const __m128i rbrace = _mm_set1_epi8('}');
+	const __m128i lbracket = _mm_set1_epi8('[');
+	const __m128i rbracket = _mm_set1_epi8(']');
+	while (end - p >= 16) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, lbrace));
+		hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, rbrace));
+		hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, lbracket));
+		hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, rbracket));
+		const int mask = _mm_movemask_epi8(hits);
+		if (mask) return p + __builtin_ctz(static_cast<unsigned>(mask));
+		p += 16;
+	}
+#endif
+	while (p < end && *p != '"' && *p != '{' && *p != '}' && *p != '[' && *p != ']') ++p;
+	return p;
+}
+
+const char *skip_container(const char *p, const char *end) {
+	int depth = 0;
+	while (true) {
+		p = find_structural(p, end);
+		if (p == end) return nullptr;
+		switch (*p) {
+		case '"':
+			p = skip_string(p, end);
+			if (!p) return nullptr;
+			break;
+		case '{':
+		case '[':
+			++depth;
+			++p;
+			break;
+		default:
+			++p;
+			if (--depth == 0) return p;
+		}
+	}
+}
+
+std::string_view unquote(std::string_view v) {
+	if (v.size() >= 2 && v.front() == '"' && v.back() == '"') return v.substr(1, v.size() - 2);
+	return v;
+}
+
+}
+
+namespace detail {
+const char *skip_ws(const char *p, const char *end) {
+	while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) ++p;
+	return p;
+}
+}
+
+const char *skip_string(const char *p, const char *end) {
+	++p; // opening quote
+	while (true) {
+		p = find_quote_or_escape(p, end);
+		if (p == end) return nullptr;
+		if (*p == '"') return p + 1;
+		p += 2; // escaped character
+		if (p > end) return nullptr;
+	}
+}
+
+const char *skip_value(const char *p, const char *end) {
+	p = detail::skip_ws(p, end);
+	if (p == end) return nullptr;
+	switch (*p) {
+	case '"':
+		return skip_string(p, end);
+	case '{':
+	case '[':
+		return skip_container(p, end);
+	default: {
+		// number / true / false / null
+		const char *start = p;
+		while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t') ++p;
+		return p == start ? nullptr : p;
+	}
+	}
+}
+
+bool object_fields(std::string_view obj, const std::string_view *keys, std::string_view *values, std::size_t n) {
+	const char *p = obj.data();
+	const char *end = p + obj.size();
+	for (std::size_t i = 0; i < n; ++i) values[i] = {};
+	p = detail::skip_ws(p, end);
+	if (p == end || *p != '{') return false;
+	p = detail::skip_ws(p + 1, end);
+	if (p < end && *p == '}') return true;
+	while (p < end) {
+		if (*p != '"') return false;
+		const char *key_end = skip_string(p, end);
+		if (!key_end) return false;
+		const std::string_view key(p + 1, static_cast<std::size_t>(key_end - p - 2));
+		p = detail::skip_ws(key_end, end);
+		if (p == end || *p != ':') return false;
+		p = detail::skip_ws(p + 1, end);
+		const char *value_end = skip_value(p, end);
+		if (!value_end) return false;
+		for (std::size_t i = 0; i < n; ++i) {
+			if (values[i].empty() && keys[i] == key) {
+				values[i] = std::string_view(p, static_cast<std::size_t>(value_end - p));
+				break;
+			}
+		}
+		p = detail::skip_ws(value_end, end);
+		if (p == end) return false;
+		if (*p == '}') return true;
+		if (*p != ',') return false;
+		p = detail::skip_ws(p + 1, end);
+	}
+	return false;
+}
+
+bool string_value(std::string_view v, std::string_view &out) {
+	if (v.size() < 2 || v.front() != '"' || v.back() != '"') return false;
+	out = v.substr(1, v.size() - 2);
+	return out.find('\\') == std::string_view::npos;
+}
+
+bool number_value(std::string_view v, double &out) {
+	v = unquote(v);
+	if (v.empty()) return false;
+#if defined(__cpp_lib_to_chars)
+	const auto r = std::from_chars(v.data(), v.data() + v.size(), out);
+	return r.ec == std::errc{} && r.ptr == v.data() + v.size();
+#else
+	// No floating-point from_chars in this standard library: strtod from a stack copy
+	char buf[64];
+	if (v.size() >= sizeof(buf)) return false;
+	std::memcpy(buf, v.data(), v.size());
+	buf[v.size()] = '\0';
+	char *parsed_end = nullptr;
+	out = std::strtod(buf, &parsed_end);
+	return parsed_end == buf + v.size();
+#endif
+}
+
+bool number_value(std::string_view v, std::int64_t &out) {
+	v = unquote(v);
+	if (v.empty()) return false;
+	const auto r = std::from_chars(v.data(), v.data() + v.size(), out);
+	return r.ec == std::errc{} && r.ptr == v.data() + v.size();
+}
+
+}
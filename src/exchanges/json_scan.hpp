@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace strategia::json_scan {
+
+// On-demand scanning of exchange frames: values are returned as raw views into
+// the frame buffer and only the fields asked for are ever looked at.
+// Well-formedness is checked only as far as needed to find the requested fields;
+// callers fall back to nlohmann::json whenever a helper returns false/nullptr.
+
+// Returns past the closing quote of the string starting at p, or nullptr.
+const char *skip_string(const char *p, const char *end);
+// Returns past the value starting at p (leading whitespace allowed), or nullptr.
+const char *skip_value(const char *p, const char *end);
+
+// Fills values[i] with the raw text of member keys[i] of the object obj
+// (left empty if absent). Keys are compared without unescaping.
+bool object_fields(std::string_view obj, const std::string_view *keys, std::string_view *values, std::size_t n);
+
+template <std::size_t N>
+bool object_fields(std::string_view obj, const std::string_view (&keys)[N], std::string_view (&values)[N]) {
+	return object_fields(obj, keys, values, N);
+}
+
+// Calls fn(element) for each raw element of the array arr; stops and fails if fn returns false.
+template <class Fn>
+bool for_each_element(std::string_view arr, Fn &&fn);
+
+// "abc" -> abc. Fails on non-strings and on escapes (we never need unescaped text).
+bool string_value(std::string_view v, std::string_view &out);
+// Accept both bare numbers and numbers quoted as strings, as exchanges send both.
+bool number_value(std::string_view v, double &out);
+bool number_value(std::string_view v, std::int64_t &out);
+
+namespace detail {
+const char *skip_ws(const char *p, const char *end);
+}
+
+template <class Fn>
+bool for_each_element(std::string_view arr, Fn &&fn) {
+	const char *p = arr.data();
+	const char *end = p + arr.size();
+	if (p == end || *p != '[') return false;
+	p = detail::skip_ws(p + 1, end);
+	if (p < end && *p == ']') return true;
+	while (p < end) {
+		const char *start = p;
+		p = skip_value(p, end);
+		if (!p) return false;
+		if (!fn(std::string_view(start, static_cast<std::size_t>(p - start)))) return false;
+		p = detail::skip_ws(p, end);
+		if (p == end) return false;
+		if (*p == ']') return true;
+		if (*p != ',') return false;
+		p = detail::skip_ws(p + 1, end);
+	}
+	return false;
+}
+
+}
@@ -1,38 +1,34 @@
 #pragma once
 
-#include "exchange_client.hpp"
-#ifdef STRATEGIA_ENABLE_WEBSOCKETS
-#include <ixwebsocket/IXWebSocket.h>
-#endif
-#include <atomic>
-#include <memory>
+#include "feed_client.hpp"
+#include "book/book_sync.hpp"
+#include <string>
+#include <vector>
 
 namespace strategia {
 
-class OkxClient final : public ExchangeClient {
-public:
-	explicit OkxClient(std::string symbol);
-	~OkxClient() override;
-
-	void start() override;
-	void stop() override;
-
-	void set_ticker_callback(TickerCallback cb) override;
-	void set_orderbook_callback(OrderBookCallback cb) override;
-
-private:
-	void run_ws();
-
-private:
-	std::string symbol_;
-#ifdef STRATEGIA_ENABLE_WEBSOCKETS
-	std::unique_ptr<ix::WebSocket> ws_;
-#endif
-	std::atomic<bool> running_{false};
-	TickerCallback on_ticker_;
-	OrderBookCallback on_orderbook_;
+// Tickers and 400-level books, subscribed with one message per connection
+// listing every instrument's args; the per-connection limit counts
+// instruments. A book that falls out of sequence is resubscribed, which
+// makes OKX push a fresh snapshot.
+struct OkxProtocol {
+	static constexpr Exchange kExchange = Exchange::Okx;
+	static constexpr const char *kName = "okx";
+	static constexpr const char *kLogName = "OKX";
+	static constexpr JournalSource kFrames = JournalSource::Okx;
+	static constexpr std::size_t kStreamsPerInstrument = 1;
+	static constexpr std::size_t kDefaultPerConnection = 100;
+	static constexpr bool kRestSnapshots = false;
+	using BookSync = OkxBookSync;
+
+	static std::string route_key(const std::string &symbol) { return symbol; }
+	static std::string url(const std::vector<std::string> &symbols);
+	static std::string subscribe(const std::vector<std::string> &symbols);
+	static std::vector<std::string> resubscribe_book(const std::string &symbol);
+	static void parse(const std::string &text, ParsedFrame &out) { parse_okx_frame(text, out); }
 };
 
-}
-
+template <typename Sink>
+using OkxClient = FeedClient<OkxProtocol, Sink>;
 
+}
@@ -0,0 +1,131 @@
+#include "rest_backfill.hpp"
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#ifdef STRATEGIA_USE_LIBCURL_REST
+#include "http/http_client.hpp"
+#else
+#include <cpr/cpr.h>
+#include <future>
+#include <memory>
+#include <thread>
+#endif
+
+namespace strategia {
+
+namespace {
+
+enum class RequestKind { Ticker, Depth };
+
+struct Request {
+	std::size_t row = 0;
+	RequestKind kind = RequestKind::Ticker;
+	std::string url;
+	bool completed = false;
+	long status_code = 0;
+	std::string body;
+};
+
+void add_requests(std::size_t idx, const MinuteSnapshot &row, std::vector<Request> &out) {
+	if (!is_null(row.last_price)) return;
+	const bool need_depth = is_null(row.best_bid_price) || is_null(row.best_ask_price);
+	auto add = [&](RequestKind kind, std::string url) {
+		Request r;
+		r.row = idx;
+		r.kind = kind;
+		r.url = std::move(url);
+		out.push_back(std::move(r));
+	};
+	if (row.exchange == "binance") {
+		add(RequestKind::Ticker, "https://api.binance.com/api/v3/ticker/price?symbol=" + row.symbol);
+		if (need_depth) add(RequestKind::Depth, "https://api.binance.com/api/v3/depth?symbol=" + row.symbol + "&limit=5");
+	} else if (row.exchange == "okx") {
+		add(RequestKind::Ticker, "https://www.okx.com/api/v5/market/ticker?instId=" + row.symbol);
+		if (need_depth) add(RequestKind::Depth, "https://www.okx.com/api/v5/market/books?instId=" + row.symbol + "&sz=5");
+	}
+}
+
+// Throws if the text does not fit the row's scale; the request then counts as missed
+std::int64_t to_fixed(const std::string &text, int scale) {
+	std::int64_t v = 0;
+	if (!parse_fixed(text, scale, v)) throw std::runtime_error("value does not fit the scale");
+	return v;
+}
+
+void read_top(const nlohmann::json &d, MinuteSnapshot &row) {
+	if (d.contains("bids") && !d["bids"].empty()) {
+		row.best_bid_price = to_fixed(d["bids"][0][0].get_ref<const std::string&>(), row.scale.price);
+		row.best_bid_amount = to_fixed(d["bids"][0][1].get_ref<const std::string&>(), row.scale.qty);
+	}
+	if (d.contains("asks") && !d["asks"].empty()) {
+		row.best_ask_price = to_fixed(d["asks"][0][0].get_ref<const std::string&>(), row.scale.price);
+		row.best_ask_amount = to_fixed(d["asks"][0][1].get_ref<const std::string&>(), row.scale.qty);
+	}
+}
+
+void apply(const Request &r, MinuteSnapshot &row) {
+	auto j = nlohmann::json::parse(r.body);
+	const bool okx = row.exchange == "okx";
+	if (okx) {
+		if (!j.contains("data") || j["data"].empty()) return;
+		const auto &d = j["data"][0];
+		if (r.kind == RequestKind::Ticker) row.last_price = to_fixed(d.value("last", "0"), row.scale.price);
+		else read_top(d, row);
+	} else {
+		if (r.kind == RequestKind::Ticker) row.last_price = to_fixed(j.value("price", "0"), row.scale.price);
+		else read_top(j, row);
+	}
+}
+
+void perform_all(std::vector<Request> &requests, std::chrono::steady_clock::time_point deadline) {
+#ifdef STRATEGIA_USE_LIBCURL_REST
+	std::vector<HttpRequest> batch(requests.size());
+	for (std::size_t i = 0; i < requests.size(); ++i) batch[i].url = requests[i].url;
+	HttpClient::shared().fetch_all(batch, deadline);
+	for (std::size_t i = 0; i < requests.size(); ++i) {
+		requests[i].completed = batch[i].completed;
+		requests[i].status_code = batch[i].status_code;
+		requests[i].body = std::move(batch[i].body);
+	}
+#else
+	// cpr has no shared event loop here: one detached blocking Get per request,
+	// awaited against the deadline, so stragglers cannot hold up the batch
+	std::vector<std::future<cpr::Response>> inflight;
+	inflight.reserve(requests.size());
+	for (const auto &r : requests) {
+		auto done = std::make_shared<std::promise<cpr::Response>>();
+		inflight.push_back(done->get_future());
+		std::thread([done, url = r.url] { done->set_value(cpr::Get(cpr::Url{url}, cpr::Parameters{})); }).detach();
+	}
+	for (std::size_t i = 0; i < requests.size(); ++i) {
+		if (inflight[i].wait_until(deadline) != std::future_status::ready) continue;
+		auto resp = inflight[i].get();
+		requests[i].completed = resp.status_code != 0;
+		requests[i].status_code = resp.status_code;
+		requests[i].body = std::move(resp.text);
+	}
+#endif
+}
+
+}
+
+std::size_t backfill_missing(std::vector<MinuteSnapshot> &rows, std::chrono::steady_clock::time_point deadline) {
+	std::vector<Request> requests;
+	for (std::size_t i = 0; i < rows.size(); ++i) add_requests(i, rows[i], requests);
+	if (requests.empty()) return 0;
+	perform_all(requests, deadline);
+	std::size_t missed = 0;
+	for (const auto &r : requests) {
+		if (!r.completed || r.status_code != 200) {
+			++missed;
+			continue;
+		}
+		try {
+			apply(r, rows[r.row]);
+		} catch (...) {
+			++missed;
+		}
+	}
+	return missed;
+}
+
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "storage/storage_writer.hpp"
+#include <chrono>
+#include <vector>
+
+namespace strategia {
+
+// Fills last price and top of book via REST for rows that saw no ticks.
+// All requests of a batch are in flight at once and bounded by one deadline;
+// whatever has not arrived by then stays empty in the row.
+// Returns the number of requests that failed or missed the deadline.
+std::size_t backfill_missing(std::vector<MinuteSnapshot> &rows, std::chrono::steady_clock::time_point deadline);
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace strategia {
+
+// Routes the symbol text of a frame to a client-local slot. Symbols of up to
+// 16 bytes (all listed spot/swap names today) are packed into two integers and
+// found in a flat open-addressed table, so the hot path compares integers
+// instead of hashing and comparing strings. Longer names use a plain map.
+// Built once before the feeds start; lookups are then read-only.
+class SymbolRouter {
+public:
+	static constexpr std::uint32_t kNoSlot = ~std::uint32_t{0};
+
+	void add(std::string_view symbol, std::uint32_t slot) {
+		if (symbol.size() > kPacked) {
+			long_[std::string(symbol)] = slot;
+			return;
+		}
+		entries_.push_back({pack(symbol), slot});
+		rebuild();
+	}
+
+	std::uint32_t find(std::string_view symbol) const {
+		if (symbol.empty()) return kNoSlot;
+		if (symbol.size() > kPacked) {
+			auto it = long_.find(std::string(symbol));
+			return it == long_.end() ? kNoSlot : it->second;
+		}
+		if (table_.empty()) return kNoSlot;
+		const Key k = pack(symbol);
+		for (std::size_t i = hash(k) & mask_;; i = (i + 1) & mask_) {
+			const Entry &e = table_[i];
+			if (e.slot == kNoSlot) return kNoSlot;
+			if (e.key.lo == k.lo && e.key.hi == k.hi) return e.slot;
+		}
+	}
+
+private:
+	static constexpr std::size_t kPacked = 16;
+
+	struct Key {
+		std::uint64_t lo = 0;
+		std::uint64_t hi = 0;
+	};
+
+	struct Entry {
+		Key key;
+		std::uint32_t slot = kNoSlot;
+	};
+
+	static Key pack(std::string_view s) {
+		char buf[kPacked] = {};
+		std::memcpy(buf, s.data(), s.size());
+		Key k;
+		std::memcpy(&k.lo, buf, 8);
+		std::memcpy(&k.hi, buf + 8, 8);
+		return k;
+	}
+
+	static std::size_t hash(const Key &k) {
+		const std::uint64_t h = (k.lo ^ (k.hi * 0x9E3779B97F4A7C15ull)) * 0xBF58476D1CE4E5B9ull;
+		return static_cast<std::size_t>(h ^ (h >> 31));
+	}
+
+	// Keeps the load factor at or below 1/2
+	void rebuild() {
+		std::size_t cap = 8;
+		while (cap < entries_.size() * 2) cap <<= 1;
+		table_.assign(cap, Entry{});
+		mask_ = cap - 1;
+		for (const auto &e : entries_) {
+			std::size_t i = hash(e.key) & mask_;
+			while (table_[i].slot != kNoSlot && !(table_[i].key.lo == e.key.lo && table_[i].key.hi == e.key.hi)) i = (i + 1) & mask_;
+			table_[i] = e;
+		}
+	}
+
+	std::vector<Entry> entries_;
+	std::vector<Entry> table_;
+	std::size_t mask_ = 0;
+	std::unordered_map<std::string, std::uint32_t> long_;
+};
+
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+
+namespace strategia {
+
+// Prices and quantities are fixed-point integers: a count of 10^-scale units,
+// with the scale fixed per instrument (64300.01 at scale 2 is 6430001). They
+// compare with integer instructions and print back exactly the decimals the
+// exchange sent. INT64_MIN marks "absent" in the same 8 bytes, where
+// std::optional<double> needs 16.
+inline constexpr std::int64_t kNullFixed = std::numeric_limits<std::int64_t>::min();
+inline constexpr int kMaxFixedScale = 18;
+
+inline bool is_null(std::int64_t v) { return v == kNullFixed; }
+
+// Averages are not exact in any scale and stay double, NaN when absent
+inline constexpr double kNullDouble = std::numeric_limits<double>::quiet_NaN();
+inline bool is_null(double v) { return std::isnan(v); }
+
+// Decimal places of an instrument's prices and quantities
+struct FixedScale {
+	std::uint8_t price = 8;
+	std::uint8_t qty = 8;
+
+	bool operator==(const FixedScale &o) const { return price == o.price && qty == o.qty; }
+};
+
+inline constexpr std::int64_t pow10_fixed(int scale) {
+	std::int64_t p = 1;
+	for (int i = 0; i < scale; ++i) p *= 10;
+	return p;
+}
+
+inline double fixed_to_double(std::int64_t v, int scale) {
+	if (v == kNullFixed) return kNullDouble;
+	return static_cast<double>(v) / static_cast<double>(pow10_fixed(scale));
+}
+
+// Decimal text as exchanges send it ("64300.01000000", "-0.5", "3") straight
+// from its digits. False on anything else, on nonzero digits beyond scale
+// and on values that do not fit; out is then untouched.
+inline bool parse_fixed(std::string_view text, int scale, std::int64_t &out) {
+	std::size_t i = 0;
+	const bool negative = !text.empty() && text[0] == '-';
+	if (!text.empty() && (text[0] == '-' || text[0] == '+')) ++i;
+	constexpr std::uint64_t kMax = static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max());
+	std::uint64_t v = 0;
+	int decimals = -1; // digits seen after the point, -1 before it
+	bool digits = false;
+	for (; i < text.size(); ++i) {
+		const char c = text[i];
+		if (c == '.') {
+			if (decimals >= 0) return false;
+			decimals = 0;
+			continue;
+		}
+		if (c < '0' || c > '9') return false;
+		digits = true;
+		const auto d = static_cast<std::uint64_t>(c - '0');
+		if (decimals == scale) {
+			if (d != 0) return false;
+			continue;
+		}
+		if (decimals >= 0) ++decimals;
+		if (v > (kMax - d) / 10) return false;
+		v = v * 10 + d;
+	}
+	if (!digits) return false;
+	for (int k = decimals < 0 ? 0 : decimals; k < scale; ++k) {
+		if (v > kMax / 10) return false;
+		v *= 10;
+	}
+	out = negative ? -static_cast<std::int64_t>(v) : static_cast<std::int64_t>(v);
+	return true;
+}
+
+// Exact decimal text without trailing zeros: 6430001 at scale 2 -> "64300.01",
+// 100 at scale 2 -> "1". Appends nothing for kNullFixed.
+inline void append_fixed(std::string &out, std::int64_t v, int scale) {
+	if (v == kNullFixed) return;
+	char buf[48];
+	char *const end = buf + sizeof(buf);
+	char *p = end;
+	std::uint64_t u = v < 0 ? 0 - static_cast<std::uint64_t>(v) : static_cast<std::uint64_t>(v);
+	bool fraction = false;
+	for (int k = 0; k < scale; ++k) {
+		const auto d = static_cast<char>(u % 10);
+		u /= 10;
+		if (d != 0 || fraction) {
+			*--p = static_cast<char>('0' + d);
+			fraction = true;
+		}
+	}
+	if (fraction) *--p = '.';
+	do {
+		*--p = static_cast<char>('0' + u % 10);
+		u /= 10;
+	} while (u != 0);
+	if (v < 0) *--p = '-';
+	out.append(p, end);
+}
+
+inline std::string fixed_to_string(std::int64_t v, int scale) {
+	std::string out;
+	append_fixed(out, v, scale);
+	return out;
+}
+
+}
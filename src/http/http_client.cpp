@@ -1,4 +1,5 @@
 #include "http_client.hpp"
+#include "metrics/metrics_registry.hpp"
 #include <curl/curl.h>
 #include <stdexcept>
 
@@ -10,33 +11,214 @@ size_t write_cb(char *ptr, size_t size, size_t nmemb, void *userdata) {
 	out->append(ptr, size * nmemb);
 	return size * nmemb;
 }
+
+void global_init() {
+	static std::once_flag once;
+	std::call_once(once, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+}
+}
+
+// CURLSH plus the locks libcurl needs to share it between threads
+struct HttpClient::Share {
+	CURLSH *sh = nullptr;
+	std::mutex locks[CURL_LOCK_DATA_LAST];
+
+	static void lock(CURL*, curl_lock_data data, curl_lock_access, void *userptr) {
+		static_cast<Share*>(userptr)->locks[data].lock();
+	}
+	static void unlock(CURL*, curl_lock_data data, void *userptr) {
+		static_cast<Share*>(userptr)->locks[data].unlock();
+	}
+};
+
+HttpClient::HttpClient(HttpOptions opts)
+	: opts_(opts), share_(new Share) {
+	auto &registry = MetricsRegistry::global();
+	const char *requests = "strategia_http_requests_total";
+	const char *requests_help = "REST requests by outcome";
+	ok_ = &registry.counter(requests, requests_help, {{"outcome", "ok"}});
+	http_errors_ = &registry.counter(requests, requests_help, {{"outcome", "http_error"}});
+	failed_ = &registry.counter(requests, requests_help, {{"outcome", "failed"}});
+	const char *connections = "strategia_http_connections_total";
+	const char *connections_help = "Connections used by completed REST requests";
+	reused_ = &registry.counter(connections, connections_help, {{"kind", "reused"}});
+	opened_ = &registry.counter(connections, connections_help, {{"kind", "opened"}});
+	duration_ = &registry.histogram("strategia_http_request_duration_seconds", "Total time of completed REST requests");
+	global_init();
+	share_->sh = curl_share_init();
+	if (!share_->sh) {
+		delete share_;
+		throw std::runtime_error("curl_share_init failed");
+	}
+	curl_share_setopt(share_->sh, CURLSHOPT_LOCKFUNC, &Share::lock);
+	curl_share_setopt(share_->sh, CURLSHOPT_UNLOCKFUNC, &Share::unlock);
+	curl_share_setopt(share_->sh, CURLSHOPT_USERDATA, share_);
+	curl_share_setopt(share_->sh, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+	curl_share_setopt(share_->sh, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+	curl_share_setopt(share_->sh, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+}
+
+HttpClient::~HttpClient() {
+	for (void *h : idle_) curl_easy_cleanup(static_cast<CURL*>(h));
+	curl_share_cleanup(share_->sh);
+	delete share_;
+}
+
+HttpClient &HttpClient::shared() {
+	static HttpClient client;
+	return client;
 }
 
 std::string HttpClient::get(const std::string &url_with_query, long &status_code) {
-	CURL *curl = curl_easy_init();
-	if (!curl) throw std::runtime_error("curl_easy_init failed");
-	std::string body;
+	return shared().fetch(url_with_query, status_code);
+}
+
+void *HttpClient::acquire(const std::string &url_with_query, std::string *body) {
+	CURL *curl = nullptr;
+	{
+		std::lock_guard<std::mutex> lk(pool_mu_);
+		if (!idle_.empty()) {
+			curl = static_cast<CURL*>(idle_.back());
+			idle_.pop_back();
+		}
+	}
+	if (curl) {
+		// Clears options only; live connections and caches stay with the handle/share
+		curl_easy_reset(curl);
+	} else {
+		curl = curl_easy_init();
+		if (!curl) throw std::runtime_error("curl_easy_init failed");
+	}
+	curl_easy_setopt(curl, CURLOPT_SHARE, share_->sh);
 	curl_easy_setopt(curl, CURLOPT_URL, url_with_query.c_str());
 	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
 	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
-	curl_easy_setopt(curl, CURLOPT_WRITEDATA, &body);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, body);
 	// reasonable timeouts
-	curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, 5000L);
-	curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, 7000L);
+	curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, opts_.connect_timeout_ms);
+	curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, opts_.timeout_ms);
+	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
 	// TLS defaults
 	curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
 	curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
+	// keep pooled connections alive between backfills
+	curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+	curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
+	if (opts_.http2) {
+		curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, static_cast<long>(CURL_HTTP_VERSION_2TLS));
+		// under curl_multi, wait for an h2 connection to multiplex on instead of opening another
+		curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+	}
+	return curl;
+}
 
+void HttpClient::release(void *handle) {
+	{
+		std::lock_guard<std::mutex> lk(pool_mu_);
+		if (idle_.size() < opts_.max_idle_handles) {
+			idle_.push_back(handle);
+			return;
+		}
+	}
+	curl_easy_cleanup(static_cast<CURL*>(handle));
+}
+
+HttpTiming HttpClient::timing_of(void *handle) {
+	CURL *curl = static_cast<CURL*>(handle);
+	curl_off_t dns = 0, connect = 0, app = 0, pre = 0, start = 0, total = 0;
+	long connects = 0;
+	curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+	curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+	curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &app);
+	curl_easy_getinfo(curl, CURLINFO_PRETRANSFER_TIME_T, &pre);
+	curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &start);
+	curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+	curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+	// libcurl reports cumulative offsets from the start of the transfer
+	HttpTiming t;
+	t.reused_connection = connects == 0;
+	if (!t.reused_connection) {
+		t.dns_us = dns;
+		t.connect_us = connect > dns ? connect - dns : 0;
+		t.tls_us = app > connect ? app - connect : 0;
+	}
+	t.ttfb_us = start > pre ? start - pre : 0;
+	t.total_us = total;
+	return t;
+}
+
+void HttpClient::record(bool completed, long status_code, const HttpTiming &timing) {
+	if (!completed) {
+		failed_->inc();
+		return;
+	}
+	(status_code >= 200 && status_code < 300 ? ok_ : http_errors_)->inc();
+	(timing.reused_connection ? reused_ : opened_)->inc();
+	duration_->observe_ns(timing.total_us * 1000);
+}
+
+void HttpClient::fetch_all(std::vector<HttpRequest> &requests, std::chrono::steady_clock::time_point deadline) {
+	if (requests.empty()) return;
+	CURLM *multi = curl_multi_init();
+	if (!multi) throw std::runtime_error("curl_multi_init failed");
+	curl_multi_setopt(multi, CURLMOPT_PIPELINING, static_cast<long>(CURLPIPE_MULTIPLEX));
+
+	std::vector<void*> handles;
+	handles.reserve(requests.size());
+	for (auto &r : requests) {
+		r.completed = false;
+		r.status_code = 0;
+		r.body.clear();
+		void *h = acquire(r.url, &r.body);
+		curl_easy_setopt(static_cast<CURL*>(h), CURLOPT_PRIVATE, &r);
+		curl_multi_add_handle(multi, static_cast<CURL*>(h));
+		handles.push_back(h);
+	}
+
+	int running = 0;
+	do {
+		if (curl_multi_perform(multi, &running) != CURLM_OK) break;
+		int queued = 0;
+		while (CURLMsg *m = curl_multi_info_read(multi, &queued)) {
+			if (m->msg != CURLMSG_DONE) continue;
+			HttpRequest *r = nullptr;
+			curl_easy_getinfo(m->easy_handle, CURLINFO_PRIVATE, &r);
+			if (r && m->data.result == CURLE_OK) {
+				r->completed = true;
+				curl_easy_getinfo(m->easy_handle, CURLINFO_RESPONSE_CODE, &r->status_code);
+				r->timing = timing_of(m->easy_handle);
+			}
+		}
+		if (running == 0) break;
+		const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+		if (left <= 0) break;
+		curl_multi_poll(multi, nullptr, 0, static_cast<int>(left < 100 ? left : 100), nullptr);
+	} while (true);
+
+	for (void *h : handles) {
+		curl_multi_remove_handle(multi, static_cast<CURL*>(h));
+		release(h);
+	}
+	curl_multi_cleanup(multi);
+	for (const auto &r : requests) record(r.completed, r.status_code, r.timing);
+}
+
+std::string HttpClient::fetch(const std::string &url_with_query, long &status_code, HttpTiming *timing) {
+	std::string body;
+	void *handle = acquire(url_with_query, &body);
+	CURL *curl = static_cast<CURL*>(handle);
 	CURLcode rc = curl_easy_perform(curl);
 	if (rc != CURLE_OK) {
-		curl_easy_cleanup(curl);
+		release(handle);
+		failed_->inc();
 		throw std::runtime_error(curl_easy_strerror(rc));
 	}
 	curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status_code);
-	curl_easy_cleanup(curl);
+	const HttpTiming t = timing_of(handle);
+	release(handle);
+	record(true, status_code, t);
+	if (timing) *timing = t;
 	return body;
 }
 
 }
-
-
@@ -1,14 +1,88 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace strategia {
 
+class Counter;
+class DurationHistogram;
+
+struct HttpOptions {
+	bool http2 = true;                // negotiate h2 over TLS via ALPN, falling back to HTTP/1.1
+	long connect_timeout_ms = 5000;
+	long timeout_ms = 7000;
+	std::size_t max_idle_handles = 8; // easy handles kept for reuse
+};
+
+// Per-request phase durations in microseconds, from libcurl's transfer info.
+// On a reused connection dns/connect/tls are 0.
+struct HttpTiming {
+	std::int64_t dns_us = 0;
+	std::int64_t connect_us = 0;
+	std::int64_t tls_us = 0;
+	std::int64_t ttfb_us = 0;  // request sent -> first response byte
+	std::int64_t total_us = 0;
+	bool reused_connection = false;
+};
+
+// One transfer of a fetch_all() batch.
+struct HttpRequest {
+	std::string url;
+	bool completed = false; // false on transport errors and when the deadline hit first
+	long status_code = 0;
+	std::string body;
+	HttpTiming timing;
+};
+
+// Pooled libcurl client. Easy handles are recycled, and connections, DNS
+// results and TLS sessions are shared between them through a CURLSH, so
+// repeated REST calls to the same host skip the TCP and TLS handshakes.
+// Every request is counted in the global MetricsRegistry. Thread-safe.
 class HttpClient {
 public:
+	explicit HttpClient(HttpOptions opts = {});
+	~HttpClient();
+	HttpClient(const HttpClient&) = delete;
+	HttpClient &operator=(const HttpClient&) = delete;
+
+	// Throws std::runtime_error on transport errors; HTTP errors are returned in status_code
+	std::string fetch(const std::string &url_with_query, long &status_code, HttpTiming *timing = nullptr);
+
+	// Runs all requests concurrently on one curl_multi loop, multiplexed over h2
+	// where the server allows it, until they finish or the deadline passes.
+	// Transfers still running at the deadline are abandoned.
+	void fetch_all(std::vector<HttpRequest> &requests, std::chrono::steady_clock::time_point deadline);
+
+	// Process-wide pool used by the REST backfill
+	static HttpClient &shared();
 	static std::string get(const std::string &url_with_query, long &status_code);
-};
 
-}
+private:
+	// A pooled handle configured for url, writing the body into *body. Only
+	// fetch() and fetch_all() drive transfers; callers go through those.
+	void *acquire(const std::string &url_with_query, std::string *body);
+	void release(void *handle);
+	static HttpTiming timing_of(void *handle);
+	void record(bool completed, long status_code, const HttpTiming &timing);
 
+	struct Share;
 
+	HttpOptions opts_;
+	Share *share_;
+	std::mutex pool_mu_;
+	std::vector<void*> idle_;
+
+	Counter *ok_;           // 2xx
+	Counter *http_errors_;  // any other status
+	Counter *failed_;       // transport error or deadline
+	Counter *reused_;
+	Counter *opened_;
+	DurationHistogram *duration_;
+};
+
+}
@@ -0,0 +1,64 @@
+#include "instrument_registry.hpp"
+#include <sstream>
+#include <stdexcept>
+
+namespace strategia {
+
+namespace {
+
+// "2" -> 2; anything outside [0, kMaxFixedScale] is rejected
+bool parse_scale(const std::string &text, std::uint8_t &out) {
+	if (text.empty() || text.size() > 2) return false;
+	int v = 0;
+	for (const char c : text) {
+		if (c < '0' || c > '9') return false;
+		v = v * 10 + (c - '0');
+	}
+	if (v > kMaxFixedScale) return false;
+	out = static_cast<std::uint8_t>(v);
+	return true;
+}
+
+std::string key_of(std::string_view exchange, std::string_view symbol) {
+	std::string key;
+	key.reserve(exchange.size() + 1 + symbol.size());
+	key.append(exchange).push_back(':');
+	key.append(symbol);
+	return key;
+}
+
+}
+
+InstrumentId InstrumentRegistry::intern(const std::string &exchange, const std::string &symbol, FixedScale scale) {
+	auto [it, inserted] = index_.try_emplace(key_of(exchange, symbol), static_cast<InstrumentId>(instruments_.size()));
+	if (inserted) instruments_.push_back(Instrument{exchange, symbol, scale});
+	return it->second;
+}
+
+InstrumentId InstrumentRegistry::find(std::string_view exchange, std::string_view symbol) const {
+	auto it = index_.find(key_of(exchange, symbol));
+	return it == index_.end() ? kInvalidInstrument : it->second;
+}
+
+InstrumentScales::InstrumentScales(const std::string &list) {
+	std::stringstream ss(list);
+	std::string item;
+	while (std::getline(ss, item, ',')) {
+		if (item.empty()) continue;
+		const std::size_t eq = item.find('=');
+		const std::size_t slash = eq == std::string::npos ? std::string::npos : item.find('/', eq);
+		FixedScale scale;
+		if (eq == std::string::npos || item.find(':') >= eq || slash == std::string::npos
+			|| !parse_scale(item.substr(eq + 1, slash - eq - 1), scale.price) || !parse_scale(item.substr(slash + 1), scale.qty)) {
+			throw std::invalid_argument("malformed instrument scale entry: " + item);
+		}
+		scales_[item.substr(0, eq)] = scale;
+	}
+}
+
+FixedScale InstrumentScales::of(std::string_view exchange, std::string_view symbol) const {
+	const auto it = scales_.find(key_of(exchange, symbol));
+	return it == scales_.end() ? FixedScale{} : it->second;
+}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "fixed_point.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace strategia {
+
+// Dense index of an (exchange, symbol) pair, valid for the process lifetime.
+using InstrumentId = std::uint32_t;
+inline constexpr InstrumentId kInvalidInstrument = ~InstrumentId{0};
+
+struct Instrument {
+	std::string exchange; // "binance" or "okx"
+	std::string symbol;   // exchange-native, e.g. "BTCUSDT" / "BTC-USDT"
+	FixedScale scale;     // decimals of its prices and quantities
+};
+
+// Resolves instruments to ids once, at subscription time, so the tick path
+// can index flat arrays instead of hashing strings.
+// Not synchronized: intern everything before the feeds are started.
+class InstrumentRegistry {
+public:
+	// Returns the existing id if the pair is already known; its scale stays
+	// the one it was first interned with.
+	InstrumentId intern(const std::string &exchange, const std::string &symbol, FixedScale scale = {});
+	InstrumentId find(std::string_view exchange, std::string_view symbol) const;
+
+	const Instrument &get(InstrumentId id) const { return instruments_[id]; }
+	std::size_t size() const { return instruments_.size(); }
+
+private:
+	std::vector<Instrument> instruments_;
+	std::unordered_map<std::string, InstrumentId> index_; // "exchange:symbol" -> id
+};
+
+// Fixed-point scales per instrument from "binance:BTCUSDT=2/5,okx:BTC-USDT=1/8"
+// (price/quantity decimals); unlisted instruments get FixedScale{}. The
+// scale must cover every decimal the exchange sends, otherwise its frames
+// are rejected as parse errors. Throws std::invalid_argument on malformed
+// lists.
+class InstrumentScales {
+public:
+	explicit InstrumentScales(const std::string &list = {});
+
+	FixedScale of(std::string_view exchange, std::string_view symbol) const;
+
+private:
+	std::unordered_map<std::string, FixedScale> scales_; // "exchange:symbol" -> scale
+};
+
+}
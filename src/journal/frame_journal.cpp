@@ -0,0 +1,259 @@
+#include "frame_journal.hpp"
+#include "time_utils.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace strategia {
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'T', 'R', 'G', 'J', 'R', 'N', '1'};
+constexpr std::uint32_t kVersion = 1;
+
+[[noreturn]] void throw_errno(const std::string &what) {
+	throw std::system_error(errno, std::generic_category(), what);
+}
+
+std::size_t round_pow2(std::size_t n) {
+	std::size_t cap = 4096;
+	while (cap < n) cap <<= 1;
+	return cap;
+}
+
+}
+
+FrameJournal::Channel::Channel(std::uint16_t id, JournalSource source, std::size_t buffer_bytes)
+	: id_(id)
+	, source_(source)
+	, buffer_(new char[round_pow2(buffer_bytes)])
+	, mask_(round_pow2(buffer_bytes) - 1) {}
+
+void FrameJournal::Channel::append(std::string_view frame, std::int64_t recv_ns) {
+	JournalRecordHeader h{};
+	h.length = static_cast<std::uint32_t>(frame.size());
+	h.connection = id_;
+	h.source = source_;
+	h.recv_ns = recv_ns;
+
+	const std::size_t capacity = mask_ + 1;
+	const std::size_t rec = journal_record_size(frame.size());
+	const std::uint64_t tail = tail_.load(std::memory_order_relaxed);
+	const std::uint64_t head = head_.load(std::memory_order_acquire);
+	std::size_t pos = tail & mask_;
+	const std::size_t to_end = capacity - pos;
+	const std::size_t need = rec <= to_end ? rec : to_end + rec;
+	if (rec > capacity / 2 || capacity - (tail - head) < need) {
+		dropped_.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	std::uint64_t next = tail;
+	if (rec > to_end) {
+		std::memcpy(buffer_.get() + pos, &kWrap, sizeof(kWrap));
+		next += to_end;
+		pos = 0;
+	}
+	std::memcpy(buffer_.get() + pos, &h, sizeof(h));
+	std::memcpy(buffer_.get() + pos + sizeof(h), frame.data(), frame.size());
+	tail_.store(next + rec, std::memory_order_release);
+}
+
+FrameJournal::FrameJournal(fs::path directory, std::size_t segment_bytes, std::size_t channel_buffer_bytes)
+	: directory_(std::move(directory))
+	, segment_bytes_(std::max(segment_bytes, round_pow2(channel_buffer_bytes))) // any buffered record fits
+	, channel_buffer_bytes_(channel_buffer_bytes) {
+	fs::create_directories(directory_);
+	open_segment();
+	writer_ = std::thread([this] { writer_loop(); });
+}
+
+FrameJournal::~FrameJournal() {
+	running_.store(false);
+	if (writer_.joinable()) writer_.join();
+	close_segment();
+}
+
+FrameJournal::Channel *FrameJournal::open_channel(JournalSource source) {
+	std::lock_guard<std::mutex> lk(channels_mu_);
+	const std::size_t id = channel_count_.load(std::memory_order_relaxed);
+	if (id == kMaxChannels) throw std::runtime_error("FrameJournal: too many channels");
+	channels_[id] = std::make_unique<Channel>(static_cast<std::uint16_t>(id), source, channel_buffer_bytes_);
+	channel_count_.store(id + 1, std::memory_order_release);
+	return channels_[id].get();
+}
+
+std::uint64_t FrameJournal::frames_dropped() const {
+	std::uint64_t total = 0;
+	const std::size_t n = channel_count_.load(std::memory_order_acquire);
+	for (std::size_t i = 0; i < n; ++i) total += channels_[i]->dropped();
+	return total;
+}
+
+void FrameJournal::open_segment() {
+	const std::int64_t created = current_unix_nanos();
+	char name[64];
+	std::snprintf(name, sizeof(name), "journal-%020lld.seg", static_cast<long long>(created));
+	const fs::path path = directory_ / name;
+	fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	if (fd_ < 0) throw_errno("open " + path.string());
+	const std::size_t size = sizeof(JournalSegmentHeader) + segment_bytes_;
+	if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) throw_errno("ftruncate journal segment");
+	void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+	if (p == MAP_FAILED) throw_errno("mmap journal segment");
+	base_ = static_cast<char*>(p);
+	mapped_ = size;
+	used_ = 0;
+
+	auto *h = reinterpret_cast<JournalSegmentHeader*>(base_);
+	std::memcpy(h->magic, kMagic, sizeof(kMagic));
+	h->version = kVersion;
+	h->capacity = segment_bytes_;
+	h->used = 0;
+	h->created_ns = created;
+}
+
+void FrameJournal::close_segment() {
+	if (!base_) return;
+	reinterpret_cast<JournalSegmentHeader*>(base_)->used = used_;
+	::munmap(base_, mapped_);
+	base_ = nullptr;
+	// Give back the unused tail of the preallocated segment
+	if (::ftruncate(fd_, static_cast<off_t>(sizeof(JournalSegmentHeader) + used_)) != 0) {
+		std::perror("ftruncate journal segment");
+	}
+	::close(fd_);
+	fd_ = -1;
+}
+
+void FrameJournal::write_record(const JournalRecordHeader &h, const char *data) {
+	const std::size_t rec = journal_record_size(h.length);
+	if (used_ + rec > segment_bytes_) {
+		close_segment();
+		open_segment();
+	}
+	char *dst = base_ + sizeof(JournalSegmentHeader) + used_;
+	std::memcpy(dst, &h, sizeof(h));
+	std::memcpy(dst + sizeof(h), data, h.length);
+	used_ += rec;
+}
+
+std::size_t FrameJournal::drain(Channel &ch) {
+	const std::size_t capacity = ch.mask_ + 1;
+	std::uint64_t head = ch.head_.load(std::memory_order_relaxed);
+	const std::uint64_t tail = ch.tail_.load(std::memory_order_acquire);
+	std::size_t frames = 0;
+	while (head != tail) {
+		const std::size_t pos = head & ch.mask_;
+		const char *p = ch.buffer_.get() + pos;
+		std::uint32_t length;
+		std::memcpy(&length, p, sizeof(length));
+		if (length == Channel::kWrap) {
+			head += capacity - pos;
+			continue;
+		}
+		JournalRecordHeader h;
+		std::memcpy(&h, p, sizeof(h));
+		write_record(h, p + sizeof(h));
+		head += journal_record_size(h.length);
+		++frames;
+	}
+	ch.head_.store(head, std::memory_order_release);
+	return frames;
+}
+
+void FrameJournal::writer_loop() {
+	for (;;) {
+		// Read the flag first so the final pass sees everything appended before stop
+		const bool running = running_.load();
+		std::size_t frames = 0;
+		const std::size_t n = channel_count_.load(std::memory_order_acquire);
+		for (std::size_t i = 0; i < n; ++i) frames += drain(*channels_[i]);
+		if (frames > 0) {
+			// Readers tailing the live segment see whole records only
+			std::atomic_thread_fence(std::memory_order_release);
+			reinterpret_cast<JournalSegmentHeader*>(base_)->used = used_;
+			frames_written_.fetch_add(frames, std::memory_order_relaxed);
+		}
+		if (!running) return;
+		if (frames == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+JournalReader::JournalReader(const fs::path &directory) {
+	for (const auto &entry : fs::directory_iterator(directory)) {
+		if (entry.is_regular_file() && entry.path().extension() == ".seg") segments_.push_back(entry.path());
+	}
+	std::sort(segments_.begin(), segments_.end());
+}
+
+JournalReader::~JournalReader() { unmap(); }
+
+void JournalReader::unmap() {
+	if (base_) ::munmap(const_cast<char*>(base_), mapped_);
+	base_ = nullptr;
+	mapped_ = 0;
+}
+
+bool JournalReader::open_next_segment() {
+	unmap();
+	while (next_segment_ < segments_.size()) {
+		const fs::path &path = segments_[next_segment_++];
+		const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) throw_errno("open " + path.string());
+		struct stat st{};
+		if (::fstat(fd, &st) != 0) {
+			::close(fd);
+			throw_errno("fstat " + path.string());
+		}
+		const auto size = static_cast<std::size_t>(st.st_size);
+		if (size < sizeof(JournalSegmentHeader)) {
+			::close(fd);
+			continue;
+		}
+		void *p = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (p == MAP_FAILED) throw_errno("mmap " + path.string());
+		base_ = static_cast<const char*>(p);
+		mapped_ = size;
+		const auto *h = reinterpret_cast<const JournalSegmentHeader*>(base_);
+		if (std::memcmp(h->magic, kMagic, sizeof(kMagic)) != 0) {
+			throw std::runtime_error("not a strategia journal segment: " + path.string());
+		}
+		used_ = std::min<std::uint64_t>(h->used, size - sizeof(JournalSegmentHeader));
+		offset_ = 0;
+		return true;
+	}
+	return false;
+}
+
+bool JournalReader::next(Frame &out) {
+	for (;;) {
+		if (base_ && offset_ + sizeof(JournalRecordHeader) <= used_) {
+			JournalRecordHeader h;
+			const char *p = base_ + sizeof(JournalSegmentHeader) + offset_;
+			std::memcpy(&h, p, sizeof(h));
+			const std::size_t rec = journal_record_size(h.length);
+			if (offset_ + rec <= used_) {
+				out.recv_ns = h.recv_ns;
+				out.connection = h.connection;
+				out.source = h.source;
+				out.payload = std::string_view(p + sizeof(h), h.length);
+				offset_ += rec;
+				return true;
+			}
+		}
+		if (!open_next_segment()) return false;
+	}
+}
+
+}
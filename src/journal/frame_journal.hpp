@@ -0,0 +1,152 @@
+#pragma once
+
+#include "cache_line.hpp"
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace strategia {
+
+// Exchange whose parser a recorded frame belongs to
+enum class JournalSource : std::uint8_t {
+	Binance = 1,
+	Okx = 2,
+	BinanceDepthSnapshot = 3, // REST depth body, prefixed with "<symbol>\n"
+};
+
+// Segment files "<directory>/journal-<created ns>.seg" sort chronologically by
+// name. Each starts with a 64-byte JournalSegmentHeader followed by records of
+// a JournalRecordHeader and the raw frame, padded to 8 bytes.
+struct JournalSegmentHeader {
+	char magic[8];           // "STRGJRN1"
+	std::uint32_t version;   // 1
+	std::uint32_t reserved0;
+	std::uint64_t capacity;  // bytes available for records
+	std::uint64_t used;      // bytes of complete records; published after the data
+	std::int64_t created_ns; // unix ns
+	char reserved[24];
+};
+static_assert(sizeof(JournalSegmentHeader) == 64, "journal segment header must stay 64 bytes");
+
+struct JournalRecordHeader {
+	std::uint32_t length;     // frame bytes, excluding header and padding
+	std::uint16_t connection; // FrameJournal::Channel::id()
+	JournalSource source;
+	std::uint8_t reserved;
+	std::int64_t recv_ns;     // unix ns, taken on the receive thread
+};
+static_assert(sizeof(JournalRecordHeader) == 16, "journal record header must stay 16 bytes");
+
+inline constexpr std::size_t journal_record_size(std::size_t length) {
+	return (sizeof(JournalRecordHeader) + length + 7) & ~std::size_t{7};
+}
+
+// Records every raw frame of every connection. The receive thread only copies
+// the stamped frame into its connection's single-producer byte ring; a
+// writer thread moves records from the rings into memory-mapped segments and
+// rolls to a new segment when the current one is full. A full ring drops the
+// frame (counted) rather than stall the socket.
+class FrameJournal {
+public:
+	class Channel;
+
+	explicit FrameJournal(std::filesystem::path directory,
+		std::size_t segment_bytes = std::size_t{256} << 20,
+		std::size_t channel_buffer_bytes = std::size_t{4} << 20);
+	~FrameJournal(); // drains every channel and trims the last segment
+	FrameJournal(const FrameJournal&) = delete;
+	FrameJournal &operator=(const FrameJournal&) = delete;
+
+	// One per connection; thread-safe, valid for the journal's lifetime
+	Channel *open_channel(JournalSource source);
+
+	std::uint64_t frames_written() const { return frames_written_.load(std::memory_order_relaxed); }
+	std::uint64_t frames_dropped() const;
+
+private:
+	static constexpr std::size_t kMaxChannels = 1024;
+
+	void writer_loop();
+	std::size_t drain(Channel &ch);
+	void write_record(const JournalRecordHeader &h, const char *data);
+	void open_segment();
+	void close_segment();
+
+	std::filesystem::path directory_;
+	std::size_t segment_bytes_;
+	std::size_t channel_buffer_bytes_;
+
+	std::mutex channels_mu_; // open_channel
+	std::unique_ptr<Channel> channels_[kMaxChannels];
+	std::atomic<std::size_t> channel_count_{0};
+
+	// writer thread only
+	int fd_ = -1;
+	char *base_ = nullptr;
+	std::size_t mapped_ = 0;
+	std::uint64_t used_ = 0;
+
+	std::atomic<std::uint64_t> frames_written_{0};
+	std::atomic<bool> running_{true};
+	std::thread writer_;
+};
+
+class FrameJournal::Channel {
+public:
+	Channel(std::uint16_t id, JournalSource source, std::size_t buffer_bytes);
+
+	// Producer thread only: enqueues a copy of the frame stamped with recv_ns (unix ns)
+	void append(std::string_view frame, std::int64_t recv_ns);
+
+	std::uint16_t id() const { return id_; }
+	std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+	friend class FrameJournal;
+	static constexpr std::uint32_t kWrap = ~std::uint32_t{0}; // rest of the ring is unused
+
+	const std::uint16_t id_;
+	const JournalSource source_;
+	std::unique_ptr<char[]> buffer_;
+	const std::size_t mask_;
+	alignas(kCacheLineSize) std::atomic<std::uint64_t> tail_{0}; // producer
+	std::atomic<std::uint64_t> dropped_{0};
+	alignas(kCacheLineSize) std::atomic<std::uint64_t> head_{0}; // writer thread
+};
+
+// Iterates the records of every segment in a journal directory in file order.
+class JournalReader {
+public:
+	struct Frame {
+		std::int64_t recv_ns = 0;
+		std::uint16_t connection = 0;
+		JournalSource source = JournalSource::Binance;
+		std::string_view payload; // valid until the next call to next()
+	};
+
+	explicit JournalReader(const std::filesystem::path &directory);
+	~JournalReader();
+	JournalReader(const JournalReader&) = delete;
+	JournalReader &operator=(const JournalReader&) = delete;
+
+	bool next(Frame &out);
+
+private:
+	bool open_next_segment();
+	void unmap();
+
+	std::vector<std::filesystem::path> segments_;
+	std::size_t next_segment_ = 0;
+	const char *base_ = nullptr;
+	std::size_t mapped_ = 0;
+	std::uint64_t used_ = 0;
+	std::uint64_t offset_ = 0;
+};
+
+}
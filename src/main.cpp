@@ -3,19 +3,56 @@
 //
 #include <iostream>
 #include <cstdlib>
+#include <sstream>
 #include "config.hpp"
 
 namespace strategia {
 void run_service(const Config &cfg);
 }
 
+// "BTCUSDT,ETHUSDT" -> {"BTCUSDT", "ETHUSDT"}
+static std::vector<std::string> split_symbols(const std::string &list) {
+    std::vector<std::string> out;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) out.push_back(item);
+    }
+    return out;
+}
+
 int main() {
     strategia::Config cfg;
-    // SYMBOL_BINANCE / SYMBOL_OKX переопределяют значения по умолчанию
-    if (const char* v = std::getenv("SYMBOL_BINANCE")) cfg.symbol_binance = v;
-    if (const char* v = std::getenv("SYMBOL_OKX")) cfg.symbol_okx = v;
+    // SYMBOL_BINANCE / SYMBOL_OKX (через запятую) переопределяют значения по умолчанию
+    if (const char* v = std::getenv("SYMBOL_BINANCE")) cfg.symbols_binance = split_symbols(v);
+    if (const char* v = std::getenv("SYMBOL_OKX")) cfg.symbols_okx = split_symbols(v);
+    if (const char* v = std::getenv("INSTRUMENT_SCALES")) cfg.instrument_scales = v;
+    if (const char* v = std::getenv("BINANCE_STREAMS_PER_CONNECTION")) cfg.binance_streams_per_connection = std::strtoul(v, nullptr, 10);
+    if (const char* v = std::getenv("OKX_INSTRUMENTS_PER_CONNECTION")) cfg.okx_instruments_per_connection = std::strtoul(v, nullptr, 10);
+    if (const char* v = std::getenv("BUCKET_WIDTH")) cfg.bucket_width = v;
+    if (const char* v = std::getenv("ROLLUPS")) cfg.rollups = v;
+    if (const char* v = std::getenv("VENUE_FEES_BPS")) cfg.venue_fees_bps = v;
+    if (const char* v = std::getenv("CONSOLIDATED_SYMBOL_MAP")) cfg.consolidated_symbol_map = v;
+    if (const char* v = std::getenv("CONSOLIDATED_MAX_QUOTE_AGE_MS")) cfg.consolidated_max_quote_age_ms = std::atol(v);
+    if (const char* v = std::getenv("CONSOLIDATED_CSV")) cfg.consolidated_csv = v;
+    if (const char* v = std::getenv("AGGREGATION_SHARDS")) cfg.aggregation_shards = std::strtoul(v, nullptr, 10);
+    if (const char* v = std::getenv("EVENT_QUEUE_CAPACITY")) cfg.event_queue_capacity = std::strtoul(v, nullptr, 10);
+    if (const char* v = std::getenv("EVENT_OVERFLOW")) cfg.event_overflow = v;
+    if (const char* v = std::getenv("JOURNAL_DIR")) cfg.journal_dir = v;
+    if (const char* v = std::getenv("JOURNAL_SEGMENT_MB")) cfg.journal_segment_mb = std::strtoul(v, nullptr, 10);
+    if (const char* v = std::getenv("SHM_NAME")) cfg.shm_name = v;
+    if (const char* v = std::getenv("SHM_RING_CAPACITY")) cfg.shm_ring_capacity = std::strtoul(v, nullptr, 10);
+    if (const char* v = std::getenv("LATENCY_CSV")) cfg.latency_csv = v;
+    if (const char* v = std::getenv("CLOCK_SYNC_INTERVAL_S")) cfg.clock_sync_interval_s = std::atol(v);
     if (const char* v = std::getenv("CSV_DIR")) cfg.csv_output_dir = v;
+    if (const char* v = std::getenv("CSV_FSYNC")) cfg.csv_fsync = std::string(v) == "1";
+    if (const char* v = std::getenv("METRICS_PORT")) cfg.metrics_port = static_cast<std::uint16_t>(std::strtoul(v, nullptr, 10));
+    if (const char* v = std::getenv("METRICS_BIND")) cfg.metrics_bind = v;
+    if (const char* v = std::getenv("BACKFILL_DEADLINE_MS")) cfg.backfill_deadline_ms = std::atol(v);
+    if (const char* v = std::getenv("COLUMNAR_DIR")) cfg.columnar_output_dir = v;
     if (const char* v = std::getenv("POSTGRES_DSN")) { cfg.postgres_dsn = v; cfg.enable_postgres = true; }
+    if (const char* v = std::getenv("POSTGRES_INGEST")) cfg.postgres_use_copy = std::string(v) != "insert";
+    if (const char* v = std::getenv("POSTGRES_ROWS_PER_COMMIT")) cfg.postgres_rows_per_commit = std::strtoul(v, nullptr, 10);
 
     try {
         strategia::run_service(cfg);
@@ -0,0 +1,61 @@
+#include "clock_sync.hpp"
+#include "time_utils.hpp"
+#include <nlohmann/json.hpp>
+#include <cpr/cpr.h>
+#include <charconv>
+#include <limits>
+#include <string>
+
+using json = nlohmann::json;
+
+namespace strategia {
+
+namespace {
+
+// Server time in unix ms from a server-time response body
+std::optional<std::int64_t> server_time_ms(std::string_view exchange, const std::string &body) {
+	const auto j = json::parse(body, nullptr, false);
+	if (j.is_discarded()) return std::nullopt;
+	// Anything but the documented shape is a failed sample, never an exception
+	if (exchange == "binance" && j.is_object() && j.contains("serverTime") && j["serverTime"].is_number_integer()) {
+		return j["serverTime"].get<std::int64_t>();
+	}
+	if (exchange == "okx" && j.is_object() && j.contains("data") && j["data"].is_array() && !j["data"].empty()) {
+		const auto &d = j["data"][0];
+		if (!d.is_object() || !d.contains("ts") || !d["ts"].is_string()) return std::nullopt;
+		const auto &ts = d["ts"].get_ref<const std::string&>();
+		std::int64_t v = 0;
+		const auto r = std::from_chars(ts.data(), ts.data() + ts.size(), v);
+		if (r.ec != std::errc() || r.ptr != ts.data() + ts.size()) return std::nullopt;
+		return v;
+	}
+	return std::nullopt;
+}
+
+}
+
+std::optional<std::int64_t> estimate_clock_offset(std::string_view exchange, int samples) {
+	std::string url;
+	if (exchange == "binance") url = "https://api.binance.com/api/v3/time";
+	else if (exchange == "okx") url = "https://www.okx.com/api/v5/public/time";
+	else return std::nullopt;
+
+	std::optional<std::int64_t> best;
+	std::int64_t best_rtt = std::numeric_limits<std::int64_t>::max();
+	for (int i = 0; i < samples; ++i) {
+		const std::int64_t sent = current_unix_nanos();
+		const auto r = cpr::Get(cpr::Url{url}, cpr::Parameters{});
+		const std::int64_t received = current_unix_nanos();
+		if (r.status_code != 200) continue;
+		const auto server_ms = server_time_ms(exchange, r.text);
+		if (!server_ms) continue;
+		const std::int64_t rtt = received - sent;
+		if (rtt < best_rtt) {
+			best_rtt = rtt;
+			best = *server_ms * 1000000 - (sent + rtt / 2);
+		}
+	}
+	return best;
+}
+
+}
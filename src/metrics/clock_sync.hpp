@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace strategia {
+
+// Exchange clock minus local wall clock in ns, from the server-time sample
+// with the shortest round trip (assumed symmetric). nullopt when every request
+// failed or the exchange has no known server-time endpoint.
+std::optional<std::int64_t> estimate_clock_offset(std::string_view exchange, int samples = 5);
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace strategia {
+
+// Log-linear histogram of non-negative integers (HdrHistogram layout with 64
+// linear sub-buckets per power of two, so every recorded value is kept to
+// within 1/64 of itself). Recording is one relaxed fetch_add, safe from any
+// number of threads. Counts only grow; interval statistics are taken as the
+// difference of two load() results.
+class HdrHistogram {
+public:
+	static constexpr std::size_t kSubBuckets = 64;
+	static constexpr std::size_t kBuckets = (64 - 6) * kSubBuckets + kSubBuckets; // covers all of uint64
+
+	void record(std::uint64_t value) {
+		counts_[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void load(std::vector<std::uint64_t> &out) const {
+		out.resize(kBuckets);
+		for (std::size_t i = 0; i < kBuckets; ++i) out[i] = counts_[i].load(std::memory_order_relaxed);
+	}
+
+	static std::size_t bucket_of(std::uint64_t v) {
+		if (v < 2 * kSubBuckets) return static_cast<std::size_t>(v);
+		const unsigned shift = static_cast<unsigned>(63 - __builtin_clzll(v)) - 6;
+		return shift * kSubBuckets + static_cast<std::size_t>(v >> shift);
+	}
+
+	// Largest value that lands in bucket i
+	static std::uint64_t bucket_max(std::size_t i) {
+		if (i < 2 * kSubBuckets) return i;
+		const std::size_t shift = i / kSubBuckets - 1;
+		const std::uint64_t mantissa = i - shift * kSubBuckets;
+		return ((mantissa + 1) << shift) - 1;
+	}
+
+	// Value at quantile q (0..1] of a count vector, e.g. an interval delta
+	static std::uint64_t quantile(const std::vector<std::uint64_t> &counts, double q) {
+		std::uint64_t total = 0;
+		for (auto c : counts) total += c;
+		if (total == 0) return 0;
+		auto rank = static_cast<std::uint64_t>(q * static_cast<double>(total) + 0.5);
+		if (rank == 0) rank = 1;
+		std::uint64_t seen = 0;
+		for (std::size_t i = 0; i < counts.size(); ++i) {
+			seen += counts[i];
+			if (seen >= rank) return bucket_max(i);
+		}
+		return bucket_max(counts.size() - 1);
+	}
+
+private:
+	std::atomic<std::uint64_t> counts_[kBuckets] = {};
+};
+
+}
@@ -0,0 +1,97 @@
+#include "latency_monitor.hpp"
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace strategia {
+
+const char *to_string(FeedChannel c) {
+	switch (c) {
+	case FeedChannel::Ticker: return "ticker";
+	case FeedChannel::Book: return "book";
+	}
+	return "?";
+}
+
+const char *to_string(LatencyStage s) {
+	switch (s) {
+	case LatencyStage::ExchangeToReceive: return "exchange_to_receive";
+	case LatencyStage::ReceiveToParse: return "receive_to_parse";
+	case LatencyStage::ParseToApply: return "parse_to_apply";
+	}
+	return "?";
+}
+
+LatencyMonitor::LatencyMonitor() {
+	for (auto &h : histograms_) h = std::make_unique<HdrHistogram>();
+}
+
+std::size_t LatencyMonitor::add_exchange(std::string_view exchange) {
+	const std::size_t found = find_exchange(exchange);
+	if (found != kNoExchange) return found;
+	if (exchanges_.size() == kMaxExchanges) throw std::runtime_error("LatencyMonitor: too many exchanges");
+	exchanges_.emplace_back(exchange);
+	return exchanges_.size() - 1;
+}
+
+std::size_t LatencyMonitor::find_exchange(std::string_view exchange) const {
+	for (std::size_t i = 0; i < exchanges_.size(); ++i) {
+		if (exchanges_[i] == exchange) return i;
+	}
+	return kNoExchange;
+}
+
+std::vector<LatencyMonitor::Percentiles> LatencyMonitor::collect() {
+	std::vector<Percentiles> out;
+	std::vector<std::uint64_t> counts;
+	for (std::size_t e = 0; e < exchanges_.size(); ++e) {
+		for (std::size_t c = 0; c < kFeedChannels; ++c) {
+			for (std::size_t s = 0; s < kLatencyStages; ++s) {
+				const std::size_t i = (e * kFeedChannels + c) * kLatencyStages + s;
+				histograms_[i]->load(counts);
+				std::vector<std::uint64_t> &prev = previous_[i];
+				prev.resize(counts.size());
+				std::uint64_t total = 0;
+				for (std::size_t b = 0; b < counts.size(); ++b) {
+					const std::uint64_t now = counts[b];
+					counts[b] = now - prev[b];
+					prev[b] = now;
+					total += counts[b];
+				}
+				if (total == 0) continue;
+
+				Percentiles p;
+				p.exchange = exchanges_[e];
+				p.channel = static_cast<FeedChannel>(c);
+				p.stage = static_cast<LatencyStage>(s);
+				p.count = total;
+				p.p50_ns = HdrHistogram::quantile(counts, 0.5);
+				p.p99_ns = HdrHistogram::quantile(counts, 0.99);
+				p.p999_ns = HdrHistogram::quantile(counts, 0.999);
+				p.max_ns = HdrHistogram::quantile(counts, 1.0);
+				p.clock_offset_ns = clock_offset(e);
+				out.push_back(std::move(p));
+			}
+		}
+	}
+	return out;
+}
+
+void append_latency_csv(const std::string &path, std::int64_t minute_unix,
+	const std::vector<LatencyMonitor::Percentiles> &rows) {
+	if (rows.empty()) return;
+	std::error_code ec;
+	const std::filesystem::path parent = std::filesystem::path(path).parent_path();
+	if (!parent.empty()) std::filesystem::create_directories(parent, ec);
+	const bool fresh = !std::filesystem::exists(path, ec) || std::filesystem::file_size(path, ec) == 0;
+	std::ofstream out(path, std::ios::app);
+	if (!out) throw std::runtime_error("cannot open " + path);
+	if (fresh) out << "minute_unix,exchange,channel,stage,count,p50_ns,p99_ns,p999_ns,max_ns,clock_offset_ns\n";
+	for (const auto &r : rows) {
+		out << minute_unix << ',' << r.exchange << ',' << to_string(r.channel) << ',' << to_string(r.stage) << ','
+			<< r.count << ',' << r.p50_ns << ',' << r.p99_ns << ',' << r.p999_ns << ',' << r.max_ns << ','
+			<< r.clock_offset_ns << '\n';
+	}
+}
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "hdr_histogram.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace strategia {
+
+enum class FeedChannel : std::uint8_t { Ticker, Book };
+inline constexpr std::size_t kFeedChannels = 2;
+
+// Where an event's time went; all stamps are unix ns on the local wall clock
+enum class LatencyStage : std::uint8_t {
+	ExchangeToReceive, // exchange event time (corrected by the clock offset) -> socket receive
+	ReceiveToParse,    // socket receive -> parsed (and book applied, for depth)
+	ParseToApply,      // parsed -> applied by the aggregation shard
+};
+inline constexpr std::size_t kLatencyStages = 3;
+
+const char *to_string(FeedChannel c);
+const char *to_string(LatencyStage s);
+
+// Latency histograms per exchange, channel and stage. Exchanges are added
+// before the feeds start; recording is lock-free from any thread.
+class LatencyMonitor {
+public:
+	static constexpr std::size_t kMaxExchanges = 8;
+	static constexpr std::size_t kNoExchange = ~std::size_t{0};
+
+	struct Percentiles {
+		std::string exchange;
+		FeedChannel channel;
+		LatencyStage stage;
+		std::uint64_t count = 0;
+		std::uint64_t p50_ns = 0;
+		std::uint64_t p99_ns = 0;
+		std::uint64_t p999_ns = 0;
+		std::uint64_t max_ns = 0;
+		std::int64_t clock_offset_ns = 0;
+	};
+
+	LatencyMonitor();
+
+	// Returns the existing index if the exchange is already known; not thread-safe
+	std::size_t add_exchange(std::string_view exchange);
+	std::size_t find_exchange(std::string_view exchange) const;
+
+	void record(std::size_t exchange, FeedChannel channel, LatencyStage stage, std::int64_t ns) {
+		histogram(exchange, channel, stage).record(ns > 0 ? static_cast<std::uint64_t>(ns) : 0);
+	}
+
+	// Exchange clock minus local clock; added to exchange-to-receive samples
+	void set_clock_offset(std::size_t exchange, std::int64_t offset_ns) {
+		clock_offsets_[exchange].store(offset_ns, std::memory_order_relaxed);
+	}
+	std::int64_t clock_offset(std::size_t exchange) const {
+		return clock_offsets_[exchange].load(std::memory_order_relaxed);
+	}
+
+	// Statistics of everything recorded since the previous call, for every
+	// histogram that saw samples. Single caller.
+	std::vector<Percentiles> collect();
+
+private:
+	HdrHistogram &histogram(std::size_t exchange, FeedChannel channel, LatencyStage stage) {
+		return *histograms_[(exchange * kFeedChannels + static_cast<std::size_t>(channel)) * kLatencyStages + static_cast<std::size_t>(stage)];
+	}
+
+	static constexpr std::size_t kHistograms = kMaxExchanges * kFeedChannels * kLatencyStages;
+
+	std::vector<std::string> exchanges_;
+	std::array<std::unique_ptr<HdrHistogram>, kHistograms> histograms_;
+	std::array<std::vector<std::uint64_t>, kHistograms> previous_; // collect() baseline
+	std::array<std::atomic<std::int64_t>, kMaxExchanges> clock_offsets_{};
+};
+
+// Appends one line per entry to a CSV file (header on first write):
+// minute_unix,exchange,channel,stage,count,p50_ns,p99_ns,p999_ns,max_ns,clock_offset_ns
+void append_latency_csv(const std::string &path, std::int64_t minute_unix,
+	const std::vector<LatencyMonitor::Percentiles> &rows);
+
+// Exchange-to-receive and receive-to-parse samples of one frame
+inline void record_frame_latency(LatencyMonitor &monitor, std::size_t exchange, FeedChannel channel,
+	std::int64_t ts_ms, std::int64_t recv_ns, std::int64_t parsed_ns) {
+	if (recv_ns == 0) return;
+	if (ts_ms > 0) {
+		monitor.record(exchange, channel, LatencyStage::ExchangeToReceive,
+			recv_ns - ts_ms * 1000000 + monitor.clock_offset(exchange));
+	}
+	monitor.record(exchange, channel, LatencyStage::ReceiveToParse, parsed_ns - recv_ns);
+}
+
+}
@@ -0,0 +1,174 @@
+#include "metrics_registry.hpp"
+#include <cstdio>
+#include <stdexcept>
+
+namespace strategia {
+
+namespace {
+
+// Upper bounds of the exposed histogram buckets, in seconds
+constexpr double kBucketBounds[] = {
+	0.00001, 0.00005, 0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1, 5, 10, 60,
+};
+
+// Label values and help text escape backslash and newline; values also escape quotes
+void append_escaped(std::string &out, const std::string &s, bool quotes) {
+	for (char c : s) {
+		if (c == '\\') out += "\\\\";
+		else if (c == '\n') out += "\\n";
+		else if (c == '"' && quotes) out += "\\\"";
+		else out += c;
+	}
+}
+
+std::string render_labels(const MetricLabels &labels) {
+	std::string out;
+	for (const auto &kv : labels) {
+		if (!out.empty()) out += ',';
+		out += kv.first;
+		out += "=\"";
+		append_escaped(out, kv.second, true);
+		out += '"';
+	}
+	return out;
+}
+
+std::string format_double(double v) {
+	char buf[32];
+	const int n = std::snprintf(buf, sizeof(buf), "%.9g", v);
+	return std::string(buf, static_cast<std::size_t>(n));
+}
+
+void append_sample(std::string &out, const std::string &name, const char *suffix,
+	const std::string &labels, const char *le, const std::string &value) {
+	out += name;
+	out += suffix;
+	if (!labels.empty() || le) {
+		out += '{';
+		out += labels;
+		if (le) {
+			if (!labels.empty()) out += ',';
+			out += "le=\"";
+			out += le;
+			out += '"';
+		}
+		out += '}';
+	}
+	out += ' ';
+	out += value;
+	out += '\n';
+}
+
+}
+
+MetricsRegistry &MetricsRegistry::global() {
+	static MetricsRegistry registry;
+	return registry;
+}
+
+MetricsRegistry::Series &MetricsRegistry::series(const std::string &name, const std::string &help, Type type, const MetricLabels &labels) {
+	std::lock_guard<std::mutex> lk(mu_);
+	Family *family = nullptr;
+	auto it = by_name_.find(name);
+	if (it != by_name_.end()) {
+		family = it->second;
+		if (family->type != type) throw std::invalid_argument("metric " + name + " registered with another type");
+	} else {
+		families_.push_back(std::make_unique<Family>(Family{name, help, type, {}}));
+		family = families_.back().get();
+		by_name_.emplace(name, family);
+	}
+	const std::string rendered = render_labels(labels);
+	for (auto &s : family->series) {
+		if (s->labels == rendered) return *s;
+	}
+	family->series.push_back(std::make_unique<Series>());
+	Series &s = *family->series.back();
+	s.labels = rendered;
+	switch (type) {
+	case Type::Counter: s.counter = std::make_unique<Counter>(); break;
+	case Type::Gauge: s.gauge = std::make_unique<Gauge>(); break;
+	case Type::Histogram: s.histogram = std::make_unique<DurationHistogram>(); break;
+	}
+	return s;
+}
+
+Counter &MetricsRegistry::counter(const std::string &name, const std::string &help, const MetricLabels &labels) {
+	return *series(name, help, Type::Counter, labels).counter;
+}
+
+Gauge &MetricsRegistry::gauge(const std::string &name, const std::string &help, const MetricLabels &labels) {
+	return *series(name, help, Type::Gauge, labels).gauge;
+}
+
+DurationHistogram &MetricsRegistry::histogram(const std::string &name, const std::string &help, const MetricLabels &labels) {
+	return *series(name, help, Type::Histogram, labels).histogram;
+}
+
+std::size_t MetricsRegistry::add_collector(std::function<void()> fn) {
+	std::lock_guard<std::mutex> lk(collectors_mu_);
+	collectors_.emplace_back(++next_collector_, std::move(fn));
+	return next_collector_;
+}
+
+void MetricsRegistry::remove_collector(std::size_t id) {
+	std::lock_guard<std::mutex> lk(collectors_mu_);
+	for (auto it = collectors_.begin(); it != collectors_.end(); ++it) {
+		if (it->first == id) {
+			collectors_.erase(it);
+			return;
+		}
+	}
+}
+
+std::string MetricsRegistry::render() const {
+	{
+		std::lock_guard<std::mutex> lk(collectors_mu_);
+		for (const auto &c : collectors_) c.second();
+	}
+	std::string out;
+	std::vector<std::uint64_t> counts;
+	std::lock_guard<std::mutex> lk(mu_);
+	for (const auto &f : families_) {
+		out += "# HELP ";
+		out += f->name;
+		out += ' ';
+		append_escaped(out, f->help, false);
+		out += "\n# TYPE ";
+		out += f->name;
+		out += ' ';
+		out += f->type == Type::Counter ? "counter" : f->type == Type::Gauge ? "gauge" : "histogram";
+		out += '\n';
+		for (const auto &s : f->series) {
+			switch (f->type) {
+			case Type::Counter:
+				append_sample(out, f->name, "", s->labels, nullptr, std::to_string(s->counter->value()));
+				break;
+			case Type::Gauge:
+				append_sample(out, f->name, "", s->labels, nullptr, std::to_string(s->gauge->value()));
+				break;
+			case Type::Histogram: {
+				s->histogram->load(counts);
+				// Bucket maxima grow with the index, so one pass fills every bound
+				std::uint64_t cumulative = 0;
+				std::size_t i = 0;
+				char le[32];
+				for (double bound : kBucketBounds) {
+					const auto bound_ns = static_cast<std::uint64_t>(bound * 1e9);
+					for (; i < counts.size() && HdrHistogram::bucket_max(i) <= bound_ns; ++i) cumulative += counts[i];
+					std::snprintf(le, sizeof(le), "%g", bound);
+					append_sample(out, f->name, "_bucket", s->labels, le, std::to_string(cumulative));
+				}
+				for (; i < counts.size(); ++i) cumulative += counts[i];
+				append_sample(out, f->name, "_bucket", s->labels, "+Inf", std::to_string(cumulative));
+				append_sample(out, f->name, "_sum", s->labels, nullptr, format_double(static_cast<double>(s->histogram->sum_ns()) / 1e9));
+				append_sample(out, f->name, "_count", s->labels, nullptr, std::to_string(cumulative));
+				break;
+			}
+			}
+		}
+	}
+	return out;
+}
+
+}
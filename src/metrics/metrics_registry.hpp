@@ -0,0 +1,130 @@
+#pragma once
+
+#include "cache_line.hpp"
+#include "hdr_histogram.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace strategia {
+
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+inline constexpr std::size_t kMetricStripes = 16;
+
+// Each thread increments its own cell of a striped metric; threads beyond
+// kMetricStripes share cells round-robin
+inline std::size_t metric_stripe() {
+	static std::atomic<std::size_t> next{0};
+	thread_local const std::size_t stripe = next.fetch_add(1, std::memory_order_relaxed) % kMetricStripes;
+	return stripe;
+}
+
+// Monotonic count. inc() is one relaxed add on a cache line owned by the
+// calling thread; the cells are summed on scrape.
+class Counter {
+public:
+	void inc(std::uint64_t n = 1) { cells_[metric_stripe()].value.fetch_add(n, std::memory_order_relaxed); }
+
+	std::uint64_t value() const {
+		std::uint64_t sum = 0;
+		for (const auto &c : cells_) sum += c.value.load(std::memory_order_relaxed);
+		return sum;
+	}
+
+private:
+	struct alignas(kCacheLineSize) Cell {
+		std::atomic<std::uint64_t> value{0};
+	};
+	std::array<Cell, kMetricStripes> cells_;
+};
+
+// Point-in-time value, last write wins
+class Gauge {
+public:
+	void set(std::int64_t v) { value_.store(v, std::memory_order_relaxed); }
+	void add(std::int64_t d) { value_.fetch_add(d, std::memory_order_relaxed); }
+	std::int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<std::int64_t> value_{0};
+};
+
+// Durations recorded in nanoseconds into an HdrHistogram; exposed as a
+// Prometheus histogram in seconds over fixed buckets, exact to within 1/64.
+class DurationHistogram {
+public:
+	void observe_ns(std::int64_t ns) {
+		const std::uint64_t v = ns > 0 ? static_cast<std::uint64_t>(ns) : 0;
+		hist_.record(v);
+		sum_ns_.fetch_add(v, std::memory_order_relaxed);
+	}
+
+	std::uint64_t sum_ns() const { return sum_ns_.load(std::memory_order_relaxed); }
+	void load(std::vector<std::uint64_t> &counts) const { hist_.load(counts); }
+
+private:
+	HdrHistogram hist_;
+	std::atomic<std::uint64_t> sum_ns_{0};
+};
+
+// Named metric families with label sets. Registration is idempotent (same
+// name and labels return the same object) and takes a lock, so callers
+// look their metrics up once and keep the reference; the objects live as
+// long as the registry.
+class MetricsRegistry {
+public:
+	// Process-wide registry the service, the HTTP client and the writers report to
+	static MetricsRegistry &global();
+
+	// Throw std::invalid_argument if name is already registered with another type
+	Counter &counter(const std::string &name, const std::string &help, const MetricLabels &labels = {});
+	Gauge &gauge(const std::string &name, const std::string &help, const MetricLabels &labels = {});
+	DurationHistogram &histogram(const std::string &name, const std::string &help, const MetricLabels &labels = {});
+
+	// Runs fn at the start of every render(), one scrape at a time, e.g. to
+	// copy statistics kept elsewhere into gauges. remove_collector() waits for
+	// a running call, so fn may capture objects destroyed right after it.
+	std::size_t add_collector(std::function<void()> fn);
+	void remove_collector(std::size_t id);
+
+	// Prometheus text exposition format 0.0.4
+	std::string render() const;
+
+private:
+	enum class Type { Counter, Gauge, Histogram };
+
+	struct Series {
+		std::string labels; // rendered: k1="v1",k2="v2"
+		std::unique_ptr<Counter> counter;
+		std::unique_ptr<Gauge> gauge;
+		std::unique_ptr<DurationHistogram> histogram;
+	};
+
+	struct Family {
+		std::string name;
+		std::string help;
+		Type type;
+		std::vector<std::unique_ptr<Series>> series;
+	};
+
+	Series &series(const std::string &name, const std::string &help, Type type, const MetricLabels &labels);
+
+	mutable std::mutex collectors_mu_;
+	std::vector<std::pair<std::size_t, std::function<void()>>> collectors_;
+	std::size_t next_collector_ = 0;
+
+	mutable std::mutex mu_;
+	std::vector<std::unique_ptr<Family>> families_; // registration order
+	std::unordered_map<std::string, Family*> by_name_;
+};
+
+}
@@ -0,0 +1,110 @@
+#include "metrics_server.hpp"
+#include <cerrno>
+#include <system_error>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace strategia {
+
+namespace {
+
+constexpr int kPollMs = 200;          // how quickly the destructor is noticed
+constexpr int kRequestTimeoutMs = 1000;
+constexpr std::size_t kMaxRequest = 8192;
+
+[[noreturn]] void throw_errno(const std::string &what) {
+	throw std::system_error(errno, std::generic_category(), what);
+}
+
+void send_all(int fd, const std::string &data) {
+	const char *p = data.data();
+	std::size_t left = data.size();
+	while (left > 0) {
+		const ssize_t n = ::send(fd, p, left, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			return; // scraper went away
+		}
+		p += n;
+		left -= static_cast<std::size_t>(n);
+	}
+}
+
+std::string response(const char *status, const char *content_type, const std::string &body) {
+	std::string out = "HTTP/1.1 ";
+	out += status;
+	out += "\r\nContent-Type: ";
+	out += content_type;
+	out += "\r\nContent-Length: " + std::to_string(body.size());
+	out += "\r\nConnection: close\r\n\r\n";
+	out += body;
+	return out;
+}
+
+}
+
+MetricsServer::MetricsServer(MetricsRegistry &registry, const std::string &bind_address, std::uint16_t port)
+	: registry_(registry) {
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	if (::inet_pton(AF_INET, bind_address.c_str(), &addr.sin_addr) != 1) {
+		throw std::system_error(EINVAL, std::generic_category(), "metrics bind address " + bind_address);
+	}
+	fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd_ < 0) throw_errno("metrics socket");
+	const int one = 1;
+	::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd_, 16) != 0) {
+		const int err = errno;
+		::close(fd_);
+		throw std::system_error(err, std::generic_category(), "metrics listen on " + bind_address + ":" + std::to_string(port));
+	}
+	socklen_t len = sizeof(addr);
+	::getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+	port_ = ntohs(addr.sin_port);
+	thread_ = std::thread([this] { serve(); });
+}
+
+MetricsServer::~MetricsServer() {
+	running_.store(false);
+	if (thread_.joinable()) thread_.join();
+	::close(fd_);
+}
+
+void MetricsServer::serve() {
+	while (running_.load()) {
+		pollfd p{fd_, POLLIN, 0};
+		if (::poll(&p, 1, kPollMs) <= 0) continue;
+		const int client = ::accept4(fd_, nullptr, nullptr, SOCK_CLOEXEC);
+		if (client < 0) continue;
+		handle(client);
+		::close(client);
+	}
+}
+
+void MetricsServer::handle(int client) {
+	// Only the request line matters; read until the end of the headers
+	std::string request;
+	char buf[1024];
+	while (request.find("\r\n\r\n") == std::string::npos && request.size() < kMaxRequest) {
+		pollfd p{client, POLLIN, 0};
+		if (::poll(&p, 1, kRequestTimeoutMs) <= 0) return;
+		const ssize_t n = ::recv(client, buf, sizeof(buf), 0);
+		if (n <= 0) return;
+		request.append(buf, static_cast<std::size_t>(n));
+	}
+	const std::string line = request.substr(0, request.find("\r\n"));
+	if (line.rfind("GET /metrics ", 0) == 0 || line.rfind("GET /metrics?", 0) == 0) {
+		send_all(client, response("200 OK", "text/plain; version=0.0.4; charset=utf-8", registry_.render()));
+	} else if (line.rfind("GET ", 0) == 0) {
+		send_all(client, response("404 Not Found", "text/plain", "not found\n"));
+	} else {
+		send_all(client, response("405 Method Not Allowed", "text/plain", "method not allowed\n"));
+	}
+}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "metrics_registry.hpp"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+namespace strategia {
+
+// Minimal HTTP/1.1 listener serving GET /metrics from a registry in the
+// Prometheus text format. One thread, one connection at a time with
+// Connection: close: scrapes are rare and small, so nothing more is needed.
+class MetricsServer {
+public:
+	// Port 0 picks a free port (see port()). Throws std::system_error if the
+	// address cannot be bound.
+	MetricsServer(MetricsRegistry &registry, const std::string &bind_address, std::uint16_t port);
+	~MetricsServer();
+	MetricsServer(const MetricsServer&) = delete;
+	MetricsServer &operator=(const MetricsServer&) = delete;
+
+	std::uint16_t port() const { return port_; }
+
+private:
+	void serve();
+	void handle(int client);
+
+	MetricsRegistry &registry_;
+	int fd_ = -1;
+	std::uint16_t port_ = 0;
+	std::atomic<bool> running_{true};
+	std::thread thread_;
+};
+
+}
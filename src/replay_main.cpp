@@ -0,0 +1,234 @@
+// Feeds a raw frame journal through the exchange clients' parsers and the
+// aggregation shards, rotating buckets on recorded receive timestamps, and
+// writes the rows through the configured storage backend.
+#include "config.hpp"
+#include "time_utils.hpp"
+#include "aggregation/aggregation_sink.hpp"
+#include "aggregation/consolidated_book.hpp"
+#include "aggregation/rollup.hpp"
+#include "aggregation/sharded_state.hpp"
+#include "exchanges/binance_client.hpp"
+#include "exchanges/okx_client.hpp"
+#include "journal/frame_journal.hpp"
+#include "shm/top_of_book_publisher.hpp"
+#include "storage/storage_factory.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
+
+using namespace strategia;
+
+namespace {
+
+struct ReplayOptions {
+	std::string journal_dir;
+	double speed = 0.0; // 0: as fast as possible, 1: recorded pace, N: N times faster
+	std::size_t shards = 2;
+	std::string bucket_width = "1m";
+	std::string rollups; // e.g. "1m,5m,1h,1d"; off when empty
+	std::string consolidated_csv; // cross-venue statistics; disabled when empty
+	std::string venue_fees_bps = "binance:10,okx:10";
+	std::string instrument_scales; // "exchange:SYMBOL=PRICE/QTY,..."; 8/8 if unlisted
+	std::string shm_name; // shared-memory top of book; disabled when empty
+	std::vector<std::string> symbols_binance; // empty: every symbol seen in the journal
+	std::vector<std::string> symbols_okx;
+	Config storage;
+};
+
+std::vector<std::string> split_symbols(const std::string &list) {
+	std::vector<std::string> out;
+	std::stringstream ss(list);
+	std::string item;
+	while (std::getline(ss, item, ',')) {
+		if (!item.empty()) out.push_back(item);
+	}
+	return out;
+}
+
+[[noreturn]] void usage() {
+	std::cerr << "usage: strategia_replay <journal_dir> [--out CSV_DIR] [--columnar DIR] [--speed N]\n"
+		"                        [--shards N] [--bucket WIDTH] [--rollups W,...]\n"
+		"                        [--consolidated CSV] [--fees VENUE:BPS,...]\n"
+		"                        [--scales EXCHANGE:SYM=PRICE/QTY,...] [--shm NAME]\n"
+		"                        [--binance SYM,...] [--okx SYM,...]\n";
+	std::exit(2);
+}
+
+ReplayOptions parse_args(int argc, char **argv) {
+	ReplayOptions o;
+	o.storage.csv_output_dir = "replay_data";
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		auto value = [&]() -> std::string {
+			if (i + 1 >= argc) usage();
+			return argv[++i];
+		};
+		if (arg == "--out") o.storage.csv_output_dir = value();
+		else if (arg == "--columnar") o.storage.columnar_output_dir = value();
+		else if (arg == "--speed") o.speed = std::atof(value().c_str());
+		else if (arg == "--shards") o.shards = std::strtoul(value().c_str(), nullptr, 10);
+		else if (arg == "--bucket") o.bucket_width = value();
+		else if (arg == "--rollups") o.rollups = value();
+		else if (arg == "--consolidated") o.consolidated_csv = value();
+		else if (arg == "--fees") o.venue_fees_bps = value();
+		else if (arg == "--scales") o.instrument_scales = value();
+		else if (arg == "--shm") o.shm_name = value();
+		else if (arg == "--binance") o.symbols_binance = split_symbols(value());
+		else if (arg == "--okx") o.symbols_okx = split_symbols(value());
+		else if (!arg.empty() && arg[0] == '-') usage();
+		else o.journal_dir = arg;
+	}
+	if (o.journal_dir.empty()) usage();
+	return o;
+}
+
+// Symbols in order of first appearance, for journals replayed without a symbol list
+void discover_symbols(ReplayOptions &o) {
+	const bool want_binance = o.symbols_binance.empty();
+	const bool want_okx = o.symbols_okx.empty();
+	if (!want_binance && !want_okx) return;
+	std::unordered_set<std::string> seen;
+	ParsedFrame frame;
+	std::string text;
+	JournalReader reader(o.journal_dir);
+	JournalReader::Frame f;
+	while (reader.next(f)) {
+		if (f.source == JournalSource::Binance && want_binance) {
+			text.assign(f.payload);
+			parse_binance_frame(text, frame);
+			if (frame.kind != FrameKind::Ignored && seen.insert("binance:" + std::string(frame.symbol)).second) {
+				o.symbols_binance.emplace_back(frame.symbol);
+			}
+		} else if (f.source == JournalSource::Okx && want_okx) {
+			text.assign(f.payload);
+			parse_okx_frame(text, frame);
+			if (frame.kind != FrameKind::Ignored && seen.insert("okx:" + std::string(frame.symbol)).second) {
+				o.symbols_okx.emplace_back(frame.symbol);
+			}
+		}
+	}
+}
+
+}
+
+int main(int argc, char **argv) {
+	ReplayOptions opts = parse_args(argc, argv);
+	try {
+		discover_symbols(opts);
+		const std::int64_t width_ms = parse_duration_ms(opts.bucket_width);
+		RollupPipeline rollups(width_ms, parse_rollup_widths(opts.rollups));
+
+		const std::unique_ptr<StorageWriter> writer = make_storage_writer(opts.storage);
+		std::unique_ptr<TopOfBookPublisher> publisher; // outlives the shard workers
+		// Block: replay must not lose events, whatever the machine's speed
+		std::unique_ptr<ConsolidatedBook> consolidated; // likewise
+		if (!opts.consolidated_csv.empty()) consolidated = std::make_unique<ConsolidatedBook>(opts.venue_fees_bps, "");
+		ShardedState shards(opts.shards, 65536, OverflowPolicy::Block);
+		const InstrumentScales scales(opts.instrument_scales);
+		std::vector<Subscription> binance_subs, okx_subs;
+		auto subscribe = [&](const std::string &exchange, const std::string &symbol, std::vector<Subscription> &subs) {
+			const FixedScale scale = scales.of(exchange, symbol);
+			const std::string group = consolidated ? consolidated->group_name(exchange, symbol) : std::string();
+			const InstrumentId id = shards.register_instrument(exchange, symbol, scale, group);
+			if (consolidated) consolidated->add_instrument(id, exchange, symbol, scale);
+			subs.push_back({symbol, id, scale});
+		};
+		for (const auto &s : opts.symbols_binance) subscribe("binance", s, binance_subs);
+		for (const auto &s : opts.symbols_okx) subscribe("okx", s, okx_subs);
+		if (!opts.shm_name.empty()) {
+			publisher = std::make_unique<TopOfBookPublisher>(opts.shm_name, shards.registry(), shards.shard_count());
+			shards.set_publisher(publisher.get());
+		}
+		shards.set_consolidated_book(consolidated.get());
+		shards.start();
+
+		// Never started: frames come from the journal instead of sockets
+		const AggregationSink sink{&shards};
+		BinanceClient<AggregationSink> binance(std::move(binance_subs), sink);
+		OkxClient<AggregationSink> okx(std::move(okx_subs), sink);
+
+		std::uint64_t frames = 0;
+		std::uint64_t buckets = 0;
+		TimeBucket current_bucket;
+		std::int64_t first_ns = 0;
+		bool started = false;
+		std::vector<MinuteSnapshot> rolled;
+		// Like the service: a failed batch is logged and the replay goes on
+		auto write = [&writer](const std::vector<MinuteSnapshot> &batch, const char *what) {
+			if (batch.empty()) return;
+			try {
+				writer->write_batch(batch);
+			} catch (const std::exception &e) {
+				std::cerr << "Storage (" << what << "): " << e.what() << "\n";
+			}
+		};
+		auto rotate = [&](const TimeBucket &bucket) {
+			auto rows = shards.snapshot_and_rotate(bucket);
+			write(rows, "buckets");
+			rolled.clear();
+			rollups.add(rows, rolled);
+			write(rolled, "rollups");
+			if (consolidated) {
+				try {
+					append_consolidated_csv(opts.consolidated_csv, consolidated->venues(), consolidated->closed());
+				} catch (const std::exception &e) {
+					std::cerr << "Consolidated stats: " << e.what() << "\n";
+				}
+			}
+			++buckets;
+		};
+
+		const auto t0 = std::chrono::steady_clock::now();
+		std::string text;
+		JournalReader reader(opts.journal_dir);
+		JournalReader::Frame f;
+		while (reader.next(f)) {
+			const TimeBucket bucket = bucket_at(f.recv_ns / 1000000, width_ms);
+			if (!started) {
+				started = true;
+				current_bucket = bucket;
+				first_ns = f.recv_ns;
+			}
+			// Every bucket boundary crossed gets its row, as the live flusher would write it
+			while (bucket.start_ms > current_bucket.start_ms) {
+				rotate(current_bucket);
+				current_bucket.start_ms += width_ms;
+			}
+			if (opts.speed > 0.0) {
+				const auto due = t0 + std::chrono::nanoseconds(static_cast<std::int64_t>((f.recv_ns - first_ns) / opts.speed));
+				std::this_thread::sleep_until(due);
+			}
+
+			text.assign(f.payload);
+			try {
+				switch (f.source) {
+				case JournalSource::Binance: binance.replay_frame(text); break;
+				case JournalSource::Okx: okx.replay_frame(text); break;
+				case JournalSource::BinanceDepthSnapshot: binance.replay_snapshot(f.payload); break;
+				}
+			} catch (const std::exception &e) {
+				std::cerr << "replay parse error: " << e.what() << "\n";
+			}
+			++frames;
+		}
+		if (started) rotate(current_bucket);
+		// Partial coarser buckets too, like the final partial bucket
+		rolled.clear();
+		rollups.flush(rolled);
+		write(rolled, "rollups");
+		shards.stop();
+
+		const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		std::cout << "replayed frames=" << frames << " buckets=" << buckets
+			<< " seconds=" << secs << " frames_per_sec=" << (secs > 0 ? static_cast<double>(frames) / secs : 0.0) << "\n";
+	} catch (const std::exception &e) {
+		std::cerr << "Fatal error: " << e.what() << "\n";
+		return 1;
+	}
+	return 0;
+}
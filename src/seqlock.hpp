@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace strategia {
+
+// Single-writer sequence lock over a trivially copyable value. Readers never
+// block the writer; they retry while a write is in progress. The payload is
+// copied through relaxed atomic words so concurrent reads are well defined.
+template<typename T>
+class Seqlock {
+	static_assert(std::is_trivially_copyable_v<T>, "Seqlock needs a trivially copyable value");
+
+public:
+	Seqlock() { store(T{}); }
+
+	// Writer side; must not be called concurrently with itself
+	void store(const T &value) {
+		std::uint64_t words[kWords] = {};
+		std::memcpy(words, &value, sizeof(T));
+		const std::uint64_t s = seq_.load(std::memory_order_relaxed);
+		seq_.store(s + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (std::size_t i = 0; i < kWords; ++i) words_[i].store(words[i], std::memory_order_relaxed);
+		seq_.store(s + 2, std::memory_order_release);
+	}
+
+	// Returns the version of the copy (even, grows by 2 per store)
+	std::uint64_t load(T &out) const {
+		for (;;) {
+			if (const std::uint64_t v = try_once(out)) return v;
+		}
+	}
+
+	// As load(), but gives up after max_tries attempts, returning 0, rather
+	// than wait forever on a writer that died mid-store (one in another process)
+	std::uint64_t try_load(T &out, std::size_t max_tries) const {
+		for (std::size_t i = 0; i < max_tries; ++i) {
+			if (const std::uint64_t v = try_once(out)) return v;
+		}
+		return 0;
+	}
+
+	std::uint64_t version() const { return seq_.load(std::memory_order_acquire); }
+
+private:
+	static constexpr std::size_t kWords = (sizeof(T) + 7) / 8;
+
+	// The version, or 0 if a store was in progress or overlapped the copy
+	std::uint64_t try_once(T &out) const {
+		const std::uint64_t s1 = seq_.load(std::memory_order_acquire);
+		if (s1 & 1) return 0;
+		std::uint64_t words[kWords];
+		for (std::size_t i = 0; i < kWords; ++i) words[i] = words_[i].load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (seq_.load(std::memory_order_relaxed) != s1) return 0;
+		std::memcpy(&out, words, sizeof(T));
+		return s1;
+	}
+
+	std::atomic<std::uint64_t> seq_{0};
+	std::atomic<std::uint64_t> words_[kWords];
+};
+
+}
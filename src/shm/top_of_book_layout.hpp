@@ -0,0 +1,121 @@
+#pragma once
+
+#include "cache_line.hpp"
+#include "fixed_point.hpp"
+#include "seqlock.hpp"
+#include <atomic>
+#include <cstdint>
+
+// Layout of the POSIX shared-memory segment strategia publishes top of book
+// into (TopOfBookPublisher) and other local processes map (TopOfBookReader).
+// Everything is fixed-size and position-independent:
+//
+//   Header                      offset 0
+//   InstrumentInfo[count]       directory_offset; index = instrument id
+//   Slot[count]                 slots_offset; latest Quote per instrument
+//   ring_count x { RingHeader, Entry[ring_capacity] }
+//                               rings_offset + r * ring_stride
+//
+// Slots and ring entries are seqlocks: readers copy them without ever
+// holding up the writer and retry only while the same entry is being written.
+// Each ring has one writer (an aggregation shard) and carries every update of
+// the instruments that writer owns, in order.
+namespace strategia::shm {
+
+inline constexpr char kMagic[8] = {'S', 'T', 'R', 'G', 'T', 'O', 'B', '1'};
+inline constexpr std::uint32_t kVersion = 1;
+
+enum class SegmentState : std::uint32_t { Init = 0, Live = 1, Closed = 2 };
+
+struct Header {
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t instrument_count;
+	std::uint32_t ring_count;
+	std::uint32_t ring_capacity; // entries per ring, a power of two
+	std::uint64_t directory_offset;
+	std::uint64_t slots_offset;
+	std::uint64_t rings_offset;
+	std::uint64_t ring_stride;
+	std::uint64_t total_size;
+	std::int64_t created_ns; // unix ns
+	std::int32_t writer_pid;
+	std::atomic<std::uint32_t> state; // SegmentState; Live is stored last, with release
+	char reserved[48];
+};
+static_assert(sizeof(Header) == 128);
+
+struct InstrumentInfo {
+	char exchange[16]; // NUL-terminated
+	char symbol[40];
+	std::uint8_t price_scale; // decimals of prices (fixed_point.hpp)
+	std::uint8_t qty_scale;   // decimals of amounts
+	char reserved[6];
+};
+static_assert(sizeof(InstrumentInfo) == 64);
+
+// Prices and amounts are fixed point at the instrument's scales, kNullFixed
+// until first seen
+struct Quote {
+	std::int64_t last_price = kNullFixed; // last trade
+	std::int64_t bid_price = kNullFixed;
+	std::int64_t bid_amount = kNullFixed;
+	std::int64_t ask_price = kNullFixed;
+	std::int64_t ask_amount = kNullFixed;
+	std::int64_t ts_ms = 0;      // exchange time of the latest update
+	std::int64_t publish_ns = 0; // writer's unix ns when published
+};
+
+enum class UpdateKind : std::uint32_t { Trade = 1, Quote = 2 };
+
+// One ring entry: what changed, and the instrument's state after it
+struct Update {
+	std::uint32_t instrument = 0;
+	UpdateKind kind = UpdateKind::Quote;
+	std::int64_t last_price = kNullFixed;
+	std::int64_t bid_price = kNullFixed;
+	std::int64_t bid_amount = kNullFixed;
+	std::int64_t ask_price = kNullFixed;
+	std::int64_t ask_amount = kNullFixed;
+	std::int64_t ts_ms = 0;
+};
+
+struct alignas(kCacheLineSize) Slot {
+	Seqlock<Quote> quote;
+};
+static_assert(sizeof(Slot) == kCacheLineSize);
+
+struct alignas(kCacheLineSize) RingHeader {
+	std::atomic<std::uint64_t> head; // updates written so far; entry k is at k % ring_capacity
+};
+
+struct alignas(kCacheLineSize) Entry {
+	Seqlock<Update> update;
+};
+static_assert(sizeof(Entry) == kCacheLineSize);
+
+// Seqlock version of entry k once written: every entry starts at version 2
+// and gains 2 per write, and k is its (k / capacity + 1)-th write
+inline constexpr std::uint64_t entry_version(std::uint64_t k, std::uint64_t capacity) {
+	return 2 * (k / capacity) + 4;
+}
+
+struct Geometry {
+	std::uint64_t directory_offset = 0;
+	std::uint64_t slots_offset = 0;
+	std::uint64_t rings_offset = 0;
+	std::uint64_t ring_stride = 0;
+	std::uint64_t total_size = 0;
+
+	static Geometry of(std::uint64_t instruments, std::uint64_t rings, std::uint64_t capacity) {
+		Geometry g;
+		g.directory_offset = sizeof(Header);
+		g.slots_offset = g.directory_offset + instruments * sizeof(InstrumentInfo);
+		g.rings_offset = g.slots_offset + instruments * sizeof(Slot);
+		g.ring_stride = sizeof(RingHeader) + capacity * sizeof(Entry);
+		g.total_size = g.rings_offset + rings * g.ring_stride;
+		return g;
+	}
+};
+
+}
@@ -0,0 +1,129 @@
+#include "top_of_book_publisher.hpp"
+#include "time_utils.hpp"
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace strategia {
+
+namespace {
+
+[[noreturn]] void throw_errno(const std::string &what) {
+	throw std::system_error(errno, std::generic_category(), what);
+}
+
+void copy_name(char *dst, const std::string &src) {
+	std::memcpy(dst, src.data(), src.size());
+	dst[src.size()] = '\0';
+}
+
+}
+
+TopOfBookPublisher::TopOfBookPublisher(const std::string &name, const InstrumentRegistry &registry,
+	std::size_t writers, std::size_t ring_capacity)
+	: name_(name)
+	, instruments_(registry.size())
+	, writers_(writers)
+	, mask_(ring_capacity - 1) {
+	if (name.size() < 2 || name[0] != '/' || name.find('/', 1) != std::string::npos) {
+		throw std::invalid_argument("shm name must be \"/name\": " + name);
+	}
+	if (writers == 0) throw std::invalid_argument("shm publisher needs at least one writer");
+	if (ring_capacity < 2 || (ring_capacity & (ring_capacity - 1)) != 0) {
+		throw std::invalid_argument("shm ring capacity must be a power of two");
+	}
+	for (InstrumentId id = 0; id < instruments_; ++id) {
+		const Instrument &in = registry.get(id);
+		if (in.exchange.size() >= sizeof(shm::InstrumentInfo::exchange) || in.symbol.size() >= sizeof(shm::InstrumentInfo::symbol)) {
+			throw std::invalid_argument("instrument name too long for shared memory: " + in.exchange + ":" + in.symbol);
+		}
+	}
+	const shm::Geometry g = shm::Geometry::of(instruments_, writers, ring_capacity);
+	size_ = g.total_size;
+	rings_offset_ = g.rings_offset;
+	ring_stride_ = g.ring_stride;
+
+	// A fresh segment every run: readers of a previous one see it closed (or
+	// its writer gone) and reattach by name
+	::shm_unlink(name_.c_str());
+	const int fd = ::shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	if (fd < 0) throw_errno("shm_open " + name_);
+	if (::ftruncate(fd, static_cast<off_t>(size_)) != 0) {
+		const int err = errno;
+		::close(fd);
+		::shm_unlink(name_.c_str());
+		throw std::system_error(err, std::generic_category(), "ftruncate " + name_);
+	}
+	void *p = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	const int err = errno;
+	::close(fd);
+	if (p == MAP_FAILED) {
+		::shm_unlink(name_.c_str());
+		throw std::system_error(err, std::generic_category(), "mmap " + name_);
+	}
+	base_ = static_cast<char*>(p);
+
+	auto *dir = reinterpret_cast<shm::InstrumentInfo*>(base_ + g.directory_offset);
+	for (InstrumentId id = 0; id < instruments_; ++id) {
+		const Instrument &in = registry.get(id);
+		copy_name(dir[id].exchange, in.exchange);
+		copy_name(dir[id].symbol, in.symbol);
+		dir[id].price_scale = in.scale.price;
+		dir[id].qty_scale = in.scale.qty;
+	}
+	slots_ = reinterpret_cast<shm::Slot*>(base_ + g.slots_offset);
+	for (std::size_t i = 0; i < instruments_; ++i) new (&slots_[i]) shm::Slot{};
+	for (std::size_t w = 0; w < writers_; ++w) {
+		new (&ring(w)) shm::RingHeader{};
+		shm::Entry *e = entries(w);
+		for (std::size_t k = 0; k < ring_capacity; ++k) new (&e[k]) shm::Entry{};
+	}
+
+	// The header goes last; Live tells readers everything else is in place
+	header_ = new (base_) shm::Header{};
+	header_->version = shm::kVersion;
+	header_->instrument_count = static_cast<std::uint32_t>(instruments_);
+	header_->ring_count = static_cast<std::uint32_t>(writers_);
+	header_->ring_capacity = static_cast<std::uint32_t>(ring_capacity);
+	header_->directory_offset = g.directory_offset;
+	header_->slots_offset = g.slots_offset;
+	header_->rings_offset = g.rings_offset;
+	header_->ring_stride = g.ring_stride;
+	header_->total_size = g.total_size;
+	header_->created_ns = current_unix_nanos();
+	header_->writer_pid = static_cast<std::int32_t>(::getpid());
+	std::memcpy(header_->magic, shm::kMagic, sizeof(shm::kMagic));
+	header_->state.store(static_cast<std::uint32_t>(shm::SegmentState::Live), std::memory_order_release);
+}
+
+TopOfBookPublisher::~TopOfBookPublisher() {
+	header_->state.store(static_cast<std::uint32_t>(shm::SegmentState::Closed), std::memory_order_release);
+	::munmap(base_, size_);
+	::shm_unlink(name_.c_str());
+}
+
+void TopOfBookPublisher::publish(std::size_t writer, InstrumentId id, shm::UpdateKind kind, shm::Quote quote) {
+	quote.publish_ns = current_unix_nanos();
+	slots_[id].quote.store(quote);
+	shm::RingHeader &r = ring(writer);
+	const std::uint64_t k = r.head.load(std::memory_order_relaxed);
+	entries(writer)[k & mask_].update.store(shm::Update{id, kind,
+		quote.last_price, quote.bid_price, quote.bid_amount, quote.ask_price, quote.ask_amount, quote.ts_ms});
+	r.head.store(k + 1, std::memory_order_release);
+}
+
+shm::RingHeader &TopOfBookPublisher::ring(std::size_t writer) const {
+	return *reinterpret_cast<shm::RingHeader*>(base_ + rings_offset_ + writer * ring_stride_);
+}
+
+shm::Entry *TopOfBookPublisher::entries(std::size_t writer) const {
+	return reinterpret_cast<shm::Entry*>(base_ + rings_offset_ + writer * ring_stride_ + sizeof(shm::RingHeader));
+}
+
+}
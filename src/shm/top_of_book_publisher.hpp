@@ -0,0 +1,50 @@
+#pragma once
+
+#include "instrument_registry.hpp"
+#include "shm/top_of_book_layout.hpp"
+#include <cstddef>
+#include <string>
+
+namespace strategia {
+
+// Writer side of the shared-memory top of book (layout in
+// shm/top_of_book_layout.hpp, reader in shm/top_of_book_reader.hpp). The
+// segment is created afresh from the registry, replacing any left by an
+// earlier run, and is marked closed and unlinked on destruction; readers
+// still mapping it keep the last state. Publishing is two seqlock stores and
+// a ring head bump: no syscalls, no locks, and readers never slow it down.
+class TopOfBookPublisher {
+public:
+	// name is a POSIX shm name ("/strategia_tob"); one ring per writer
+	// thread, each ring_capacity entries (a power of two)
+	TopOfBookPublisher(const std::string &name, const InstrumentRegistry &registry,
+		std::size_t writers, std::size_t ring_capacity = 65536);
+	~TopOfBookPublisher();
+
+	TopOfBookPublisher(const TopOfBookPublisher&) = delete;
+	TopOfBookPublisher &operator=(const TopOfBookPublisher&) = delete;
+
+	// Called by writer `writer` only, for instruments only it publishes.
+	// Stamps publish_ns.
+	void publish(std::size_t writer, InstrumentId id, shm::UpdateKind kind, shm::Quote quote);
+
+	const std::string &name() const { return name_; }
+	std::size_t size() const { return size_; }
+
+private:
+	shm::RingHeader &ring(std::size_t writer) const;
+	shm::Entry *entries(std::size_t writer) const;
+
+	std::string name_;
+	char *base_ = nullptr;
+	std::size_t size_ = 0;
+	shm::Header *header_ = nullptr;
+	shm::Slot *slots_ = nullptr;
+	std::size_t instruments_ = 0;
+	std::size_t writers_ = 0;
+	std::uint64_t mask_ = 0;
+	std::uint64_t rings_offset_ = 0;
+	std::uint64_t ring_stride_ = 0;
+};
+
+}
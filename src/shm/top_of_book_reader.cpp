@@ -0,0 +1,124 @@
+#include "top_of_book_reader.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace strategia {
+
+namespace {
+
+[[noreturn]] void throw_errno(const std::string &what) {
+	throw std::system_error(errno, std::generic_category(), what);
+}
+
+// The geometry a header claims must be the one its counts produce and fit the file
+bool consistent(const shm::Header &h, std::size_t file_size) {
+	if (h.ring_capacity < 2 || (h.ring_capacity & (h.ring_capacity - 1)) != 0) return false;
+	const shm::Geometry g = shm::Geometry::of(h.instrument_count, h.ring_count, h.ring_capacity);
+	return g.directory_offset == h.directory_offset && g.slots_offset == h.slots_offset
+		&& g.rings_offset == h.rings_offset && g.ring_stride == h.ring_stride
+		&& g.total_size == h.total_size && h.total_size <= file_size;
+}
+
+}
+
+TopOfBookReader::TopOfBookReader(const std::string &name) {
+	const int fd = ::shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+	if (fd < 0) throw_errno("shm_open " + name);
+	struct stat st{};
+	if (::fstat(fd, &st) != 0) {
+		const int err = errno;
+		::close(fd);
+		throw std::system_error(err, std::generic_category(), "fstat " + name);
+	}
+	size_ = static_cast<std::size_t>(st.st_size);
+	if (size_ < sizeof(shm::Header)) {
+		::close(fd);
+		throw std::runtime_error(name + " is not a top-of-book segment (or is still being created)");
+	}
+	void *p = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+	const int err = errno;
+	::close(fd);
+	if (p == MAP_FAILED) throw std::system_error(err, std::generic_category(), "mmap " + name);
+	base_ = static_cast<const char*>(p);
+	header_ = reinterpret_cast<const shm::Header*>(base_);
+
+	const auto state = static_cast<shm::SegmentState>(header_->state.load(std::memory_order_acquire));
+	const char *problem = nullptr;
+	if (state == shm::SegmentState::Init) problem = " is still being created";
+	else if (std::memcmp(header_->magic, shm::kMagic, sizeof(shm::kMagic)) != 0) problem = " is not a top-of-book segment";
+	else if (header_->version != shm::kVersion) problem = " has an unsupported layout version";
+	else if (!consistent(*header_, size_)) problem = " has an inconsistent header";
+	if (problem) {
+		::munmap(const_cast<char*>(base_), size_);
+		throw std::runtime_error(name + problem);
+	}
+
+	directory_ = reinterpret_cast<const shm::InstrumentInfo*>(base_ + header_->directory_offset);
+	slots_ = reinterpret_cast<const shm::Slot*>(base_ + header_->slots_offset);
+	cursors_.resize(header_->ring_count);
+	for (std::size_t r = 0; r < cursors_.size(); ++r) {
+		const auto *ring = reinterpret_cast<const shm::RingHeader*>(base_ + header_->rings_offset + r * header_->ring_stride);
+		cursors_[r] = ring->head.load(std::memory_order_acquire);
+	}
+}
+
+TopOfBookReader::~TopOfBookReader() {
+	::munmap(const_cast<char*>(base_), size_);
+}
+
+std::uint32_t TopOfBookReader::find(std::string_view exchange, std::string_view symbol) const {
+	for (std::uint32_t id = 0; id < header_->instrument_count; ++id) {
+		if (exchange == directory_[id].exchange && symbol == directory_[id].symbol) return id;
+	}
+	return kNotFound;
+}
+
+std::uint64_t TopOfBookReader::read(std::uint32_t id, shm::Quote &out) const {
+	if (id >= header_->instrument_count) return 0;
+	const std::uint64_t version = slots_[id].quote.try_load(out, kReadTries);
+	if (version == 0) ++stalled_;
+	return version;
+}
+
+bool TopOfBookReader::live() const {
+	if (header_->state.load(std::memory_order_acquire) != static_cast<std::uint32_t>(shm::SegmentState::Live)) return false;
+	return ::kill(header_->writer_pid, 0) == 0 || errno == EPERM;
+}
+
+bool TopOfBookReader::next(std::size_t r, shm::Update &out) {
+	const std::uint64_t capacity = header_->ring_capacity;
+	const char *ring = base_ + header_->rings_offset + r * header_->ring_stride;
+	const auto &head = reinterpret_cast<const shm::RingHeader*>(ring)->head;
+	const auto *entries = reinterpret_cast<const shm::Entry*>(ring + sizeof(shm::RingHeader));
+	std::uint64_t &cursor = cursors_[r];
+	for (;;) {
+		const std::uint64_t h = head.load(std::memory_order_acquire);
+		if (cursor >= h) return false;
+		if (h - cursor > capacity) {
+			lost_ += h - capacity - cursor;
+			cursor = h - capacity;
+		}
+		const std::uint64_t version = entries[cursor & (capacity - 1)].update.try_load(out, kReadTries);
+		if (version == 0) {
+			// Retried on the next poll; a writer that died mid-store leaves the ring here
+			++stalled_;
+			return false;
+		}
+		if (version == shm::entry_version(cursor, capacity)) {
+			++cursor;
+			return true;
+		}
+		// Rewritten while it was being copied: the writer lapped this reader
+		++lost_;
+		++cursor;
+	}
+}
+
+}
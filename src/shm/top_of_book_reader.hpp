@@ -0,0 +1,96 @@
+#pragma once
+
+#include "shm/top_of_book_layout.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace strategia {
+
+// Read side of the shared-memory top of book, for other processes on the
+// host (link strategia_shm; it has no other dependencies). Maps the segment
+// read-only, so a reader can neither corrupt it nor slow the writer down:
+//
+//   TopOfBookReader tob("/strategia_tob");
+//   const std::uint32_t id = tob.find("binance", "BTCUSDT");
+//   shm::Quote q;
+//   if (tob.read(id, q) != 0) use(q.bid_price, tob.instrument(id).price_scale);
+//   tob.poll([](const shm::Update &u) { ... });
+//
+// One reader is not thread-safe (poll keeps cursors); use one per thread.
+class TopOfBookReader {
+public:
+	static constexpr std::uint32_t kNotFound = std::numeric_limits<std::uint32_t>::max();
+
+	// Throws std::system_error if the segment does not exist and
+	// std::runtime_error if it is not a finished segment of this layout
+	explicit TopOfBookReader(const std::string &name);
+	~TopOfBookReader();
+
+	TopOfBookReader(const TopOfBookReader&) = delete;
+	TopOfBookReader &operator=(const TopOfBookReader&) = delete;
+
+	std::uint32_t instrument_count() const { return header_->instrument_count; }
+	const shm::InstrumentInfo &instrument(std::uint32_t id) const { return directory_[id]; }
+	// Instrument id by exchange and exchange-native symbol, kNotFound if absent
+	std::uint32_t find(std::string_view exchange, std::string_view symbol) const;
+
+	// Latest quote of an instrument. Returns its version, which grows with
+	// every update: 2 until the first one. Returns 0 for an unknown id, or if
+	// the slot stayed mid-write through kReadTries attempts (a writer killed
+	// while storing it); out is then unchanged.
+	std::uint64_t read(std::uint32_t id, shm::Quote &out) const;
+
+	// Calls fn(const shm::Update &) for up to max updates published since the
+	// previous poll (since attaching, on the first). Updates of one instrument
+	// arrive in order. Updates the writer overwrote before this reader got to
+	// them are skipped and counted in lost(). A ring whose next entry stays
+	// mid-write is left there, counted in stalled(), until a later poll.
+	// Returns how many were delivered.
+	template <typename Fn>
+	std::size_t poll(Fn &&fn, std::size_t max = std::numeric_limits<std::size_t>::max());
+
+	std::uint64_t lost() const { return lost_; }
+	// Reads and polls that gave up on a slot or entry stuck mid-write
+	std::uint64_t stalled() const { return stalled_; }
+
+	// False once the writer has closed the segment or its process is gone;
+	// a restarted writer creates a new segment, so reattach by name
+	bool live() const;
+	std::int64_t created_ns() const { return header_->created_ns; }
+
+private:
+	// Seqlock attempts before a slot or entry counts as stuck: far longer than
+	// a store takes, short enough not to hang on a dead writer
+	static constexpr std::size_t kReadTries = 1 << 16;
+
+	// Next update of a ring; false if there is none or it is stuck mid-write
+	bool next(std::size_t ring, shm::Update &out);
+
+	const char *base_ = nullptr;
+	std::size_t size_ = 0;
+	const shm::Header *header_ = nullptr;
+	const shm::InstrumentInfo *directory_ = nullptr;
+	const shm::Slot *slots_ = nullptr;
+	std::vector<std::uint64_t> cursors_; // next update to read, per ring
+	std::uint64_t lost_ = 0;
+	mutable std::uint64_t stalled_ = 0;
+};
+
+template <typename Fn>
+std::size_t TopOfBookReader::poll(Fn &&fn, std::size_t max) {
+	std::size_t n = 0;
+	shm::Update u;
+	for (std::size_t r = 0; r < cursors_.size(); ++r) {
+		while (n < max && next(r, u)) {
+			fn(static_cast<const shm::Update&>(u));
+			++n;
+		}
+	}
+	return n;
+}
+
+}
@@ -0,0 +1,221 @@
+#include "columnar_writer.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace strategia {
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'T', 'R', 'G', 'C', 'O', 'L', '1'};
+constexpr std::uint32_t kVersion = 2;
+constexpr std::uint64_t kMinGrowth = 4096; // elements
+
+[[noreturn]] void throw_errno(const std::string &what) {
+	throw std::system_error(errno, std::generic_category(), what);
+}
+
+}
+
+MappedColumn::MappedColumn(const fs::path &path, std::int32_t scale) {
+	fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd_ < 0) throw_errno("open " + path.string());
+	struct stat st{};
+	if (::fstat(fd_, &st) != 0) throw_errno("fstat " + path.string());
+	if (static_cast<std::size_t>(st.st_size) < sizeof(ColumnHeader)) {
+		map(kMinGrowth);
+		ColumnHeader &h = header();
+		std::memcpy(h.magic, kMagic, sizeof(kMagic));
+		h.version = kVersion;
+		h.elem_size = sizeof(std::int64_t);
+		h.count = 0;
+		h.capacity = kMinGrowth;
+		h.base = 0;
+		h.scale = scale;
+	} else {
+		map((static_cast<std::uint64_t>(st.st_size) - sizeof(ColumnHeader)) / sizeof(std::int64_t));
+		if (std::memcmp(header().magic, kMagic, sizeof(kMagic)) != 0) {
+			throw std::runtime_error("not a strategia column file: " + path.string());
+		}
+		if (scale >= 0 && (header().version < 2 || header().scale != scale)) {
+			throw std::runtime_error(path.string() + " holds values at another scale; move it away to change the scale");
+		}
+	}
+}
+
+MappedColumn::~MappedColumn() {
+	if (base_) ::munmap(base_, mapped_);
+	if (fd_ >= 0) ::close(fd_);
+}
+
+void MappedColumn::map(std::uint64_t capacity) {
+	const std::size_t size = sizeof(ColumnHeader) + capacity * sizeof(std::int64_t);
+	if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) throw_errno("ftruncate column");
+	if (base_) ::munmap(base_, mapped_);
+	void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+	if (p == MAP_FAILED) {
+		base_ = nullptr;
+		throw_errno("mmap column");
+	}
+	base_ = static_cast<char*>(p);
+	mapped_ = size;
+}
+
+void MappedColumn::reserve(std::uint64_t n) {
+	if (n <= header().capacity) return;
+	const std::uint64_t capacity = std::max(n, header().capacity * 2);
+	map(capacity);
+	header().capacity = capacity;
+}
+
+void MappedColumn::truncate(std::uint64_t n) {
+	if (header().count > n) header().count = n;
+}
+
+void MappedColumn::put(std::uint64_t i, std::int64_t v) {
+	reserve(i + 1);
+	values()[i] = v;
+	header().count = i + 1;
+}
+
+void MappedColumn::put(std::uint64_t i, double v) {
+	std::int64_t bits;
+	std::memcpy(&bits, &v, sizeof(bits));
+	put(i, bits);
+}
+
+void MappedColumn::put_bit(std::uint64_t i, bool v) {
+	reserve(i / 64 + 1);
+	std::int64_t &word = values()[i / 64];
+	const std::int64_t mask = std::int64_t{1} << (i % 64);
+	word = v ? (word | mask) : (word & ~mask);
+	header().count = i + 1;
+}
+
+struct ColumnarWriter::Series {
+	// Fixed-point columns in MinuteSnapshot order; true for amounts, which use the quantity scale
+	static constexpr std::pair<const char*, bool> kFixed[] = {
+		{"last_price", false}, {"best_bid_price", false}, {"best_bid_amount", true}, {"best_ask_price", false},
+		{"best_ask_amount", true}, {"open", false}, {"high", false}, {"low", false}, {"close", false},
+		{"spread_min", false}, {"spread_max", false}};
+	static constexpr std::size_t kFixedCount = sizeof(kFixed) / sizeof(kFixed[0]);
+	// float64 columns
+	static constexpr const char *kMeans[] = {"twap_mid", "spread_mean"};
+	static constexpr std::size_t kMeanCount = sizeof(kMeans) / sizeof(kMeans[0]);
+
+	// Minute series keep minute_unix.col/minute.idx; other widths are keyed in ms
+	Series(const fs::path &dir, std::int64_t width_ms, FixedScale scale)
+		: step(width_ms == kMinuteMs ? 60 : width_ms)
+		, key(dir / (width_ms == kMinuteMs ? "minute_unix.col" : "bucket_start_ms.col"))
+		, tick_count(dir / "tick_count.col")
+		, index(dir / (width_ms == kMinuteMs ? "minute.idx" : "bucket.idx")) {
+		for (std::size_t i = 0; i < kFixedCount; ++i) {
+			const std::string name = kFixed[i].first;
+			fixed[i] = std::make_unique<MappedColumn>(dir / (name + ".col"), kFixed[i].second ? scale.qty : scale.price);
+			fixed_nulls[i] = std::make_unique<MappedColumn>(dir / (name + ".nul"));
+		}
+		for (std::size_t i = 0; i < kMeanCount; ++i) {
+			means[i] = std::make_unique<MappedColumn>(dir / (std::string(kMeans[i]) + ".col"));
+			mean_nulls[i] = std::make_unique<MappedColumn>(dir / (std::string(kMeans[i]) + ".nul"));
+		}
+
+		// A row cut short by an error or a crash left some columns ahead of
+		// the key; drop the partial row so the next one lines up again
+		const std::uint64_t rows = key.header().count;
+		tick_count.truncate(rows);
+		for (std::size_t i = 0; i < kFixedCount; ++i) {
+			fixed[i]->truncate(rows);
+			fixed_nulls[i]->truncate(rows);
+		}
+		for (std::size_t i = 0; i < kMeanCount; ++i) {
+			means[i]->truncate(rows);
+			mean_nulls[i]->truncate(rows);
+		}
+		// The index is written after the key; redo the last row's entry in case it was not
+		if (rows > 0) index_row(key.values()[rows - 1], static_cast<std::int64_t>(rows - 1));
+	}
+
+	static std::int64_t fixed_field(const MinuteSnapshot &r, std::size_t i) {
+		const std::int64_t fields[kFixedCount] = {
+			r.last_price, r.best_bid_price, r.best_bid_amount, r.best_ask_price, r.best_ask_amount,
+			r.open, r.high, r.low, r.close, r.spread_min, r.spread_max};
+		return fields[i];
+	}
+
+	void index_row(std::int64_t bucket, std::int64_t row) {
+		if (index.header().count == 0) index.header().base = bucket;
+		const std::int64_t base = index.header().base;
+		if (bucket < base) return; // before the first indexed bucket; still scannable via the key column
+		const auto slot = static_cast<std::uint64_t>((bucket - base) / step);
+		index.reserve(slot + 1); // may remap: header references are taken afterwards
+		ColumnHeader &h = index.header();
+		for (std::uint64_t i = h.count; i < slot; ++i) index.values()[i] = -1;
+		index.values()[slot] = row;
+		if (slot + 1 > h.count) h.count = slot + 1;
+	}
+
+	// Every column is written at the key's row, so a row retried after a
+	// throw overwrites the part that made it
+	void append(const MinuteSnapshot &r) {
+		const std::uint64_t row = key.header().count;
+		for (std::size_t i = 0; i < kFixedCount; ++i) {
+			const std::int64_t v = fixed_field(r, i);
+			fixed[i]->put(row, v);
+			fixed_nulls[i]->put_bit(row, !is_null(v));
+		}
+		const double mean_values[kMeanCount] = {r.twap_mid, r.spread_mean};
+		for (std::size_t i = 0; i < kMeanCount; ++i) {
+			means[i]->put(row, mean_values[i]);
+			mean_nulls[i]->put_bit(row, !is_null(mean_values[i]));
+		}
+		tick_count.put(row, r.tick_count);
+		// key last: readers take its count as the number of complete rows
+		key.put(row, bucket_key(r));
+		index_row(bucket_key(r), static_cast<std::int64_t>(row));
+	}
+
+	std::int64_t step; // key units per index slot
+	MappedColumn key;
+	MappedColumn tick_count;
+	MappedColumn index;
+	std::unique_ptr<MappedColumn> fixed[kFixedCount];
+	std::unique_ptr<MappedColumn> fixed_nulls[kFixedCount];
+	std::unique_ptr<MappedColumn> means[kMeanCount];
+	std::unique_ptr<MappedColumn> mean_nulls[kMeanCount];
+};
+
+ColumnarWriter::ColumnarWriter(std::string directory)
+	: dir_(std::move(directory)) {}
+
+ColumnarWriter::~ColumnarWriter() = default;
+
+void ColumnarWriter::ensure_schema() {
+	fs::create_directories(dir_);
+}
+
+ColumnarWriter::Series &ColumnarWriter::series_for(const MinuteSnapshot &row) {
+	const std::string name = row.exchange + "_" + row.symbol + bucket_suffix(row);
+	auto &s = series_[name];
+	if (!s) {
+		const fs::path dir = dir_ / name;
+		fs::create_directories(dir);
+		s = std::make_unique<Series>(dir, row.bucket_width_ms, row.scale);
+	}
+	return *s;
+}
+
+void ColumnarWriter::write_batch(const std::vector<MinuteSnapshot>& rows) {
+	const StorageMetrics::Batch batch(metrics_, rows.size());
+	for (const auto &row : rows) series_for(row).append(row);
+}
+
+}
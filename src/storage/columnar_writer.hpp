@@ -0,0 +1,86 @@
+#pragma once
+
+#include "storage_writer.hpp"
+#include "storage_metrics.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace strategia {
+
+// On-disk layout, one directory per exchange_symbol holding append-only files
+// (exchange_symbol_<width> for buckets other than one minute, see bucket_suffix):
+//   minute_unix.col            int64, one per row (ascending unless the clock went back);
+//                              bucket_start_ms.col for other widths
+//   tick_count.col             int64
+//   <name>.col                 prices and amounts: int64 fixed point with ColumnHeader::scale
+//                              decimals, INT64_MIN when null; twap_mid, spread_mean: float64,
+//                              NaN when null
+//   <name>.nul                 validity bitmap for <name>.col, bit i of word i/64, 1 = present
+//   minute.idx                 int64 row number per minute since ColumnHeader::base, -1 = no row;
+//                              bucket.idx, one entry per bucket, for other widths
+// Every file starts with a 64-byte ColumnHeader; data follows at offset 64, so
+// readers can mmap a file and scan the values as a plain array.
+struct ColumnHeader {
+	char magic[8];           // "STRGCOL1"
+	std::uint32_t version;   // 2 (1: prices and amounts were float64)
+	std::uint32_t elem_size; // bytes per element (8)
+	std::uint64_t count;     // valid elements (bits for .nul files); published after the data
+	std::uint64_t capacity;  // elements the file is sized for
+	std::int64_t base;       // minute.idx/bucket.idx: key of entry 0
+	std::int32_t scale;      // fixed-point columns: decimals of the values; -1 otherwise
+	char reserved[20];
+};
+static_assert(sizeof(ColumnHeader) == 64, "column header must stay 64 bytes");
+
+// Maps one column file and grows it in place as it is appended to.
+class MappedColumn {
+public:
+	// scale >= 0 opens a fixed-point column; an existing file written at
+	// another scale, or before version 2, throws std::runtime_error
+	explicit MappedColumn(const std::filesystem::path &path, std::int32_t scale = -1);
+	~MappedColumn();
+	MappedColumn(const MappedColumn&) = delete;
+	MappedColumn &operator=(const MappedColumn&) = delete;
+
+	ColumnHeader &header() { return *reinterpret_cast<ColumnHeader*>(base_); }
+	std::int64_t *values() { return reinterpret_cast<std::int64_t*>(base_ + sizeof(ColumnHeader)); }
+	// Makes room for at least n elements
+	void reserve(std::uint64_t n);
+	// Drops elements from n on, e.g. those of a row that was never completed
+	void truncate(std::uint64_t n);
+
+	// Write element i and publish count i + 1, so writing a row again
+	// overwrites whatever part of it made it to the file before
+	void put(std::uint64_t i, std::int64_t v);
+	void put(std::uint64_t i, double v);
+	void put_bit(std::uint64_t i, bool v);
+
+private:
+	void map(std::uint64_t capacity);
+
+	int fd_ = -1;
+	char *base_ = nullptr;
+	std::size_t mapped_ = 0;
+};
+
+class ColumnarWriter final : public StorageWriter {
+public:
+	explicit ColumnarWriter(std::string directory);
+	~ColumnarWriter() override;
+
+	void ensure_schema() override;
+	void write_batch(const std::vector<MinuteSnapshot>& rows) override;
+
+private:
+	struct Series;
+	Series &series_for(const MinuteSnapshot &row);
+
+	std::filesystem::path dir_;
+	StorageMetrics metrics_{"columnar"};
+	std::unordered_map<std::string, std::unique_ptr<Series>> series_; // by directory name
+};
+
+}
@@ -1,44 +1,178 @@
 #include "csv_writer.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cerrno>
+#include <cstdio>
 #include <fstream>
-#include <iomanip>
+#include <iostream>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace fs = std::filesystem;
 
 namespace strategia {
 
-CsvWriter::CsvWriter(std::string directory)
-	: dir_(std::move(directory)) {}
+namespace {
+
+// Follows the key column
+constexpr const char *kHeaderColumns = ",exchange,symbol,last_price,best_bid_price,best_bid_amount,best_ask_price,best_ask_amount,open,high,low,close,tick_count,twap_mid,spread_min,spread_max,spread_mean\n";
+
+std::string file_name_for(const MinuteSnapshot &row) {
+	// One file per exchange+symbol and bucket width, e.g., binance_BTCUSDT.csv, binance_BTCUSDT_1s.csv
+	return row.exchange + "_" + row.symbol + bucket_suffix(row) + ".csv";
+}
+
+// First line of an existing file, empty when the file is missing or empty
+std::string header_line(const fs::path &path) {
+	std::ifstream in(path);
+	std::string line;
+	std::getline(in, line);
+	return line;
+}
+
+// binance_BTCUSDT_1s.csv -> binance_BTCUSDT_1s.v2.csv
+std::string versioned_name(const std::string &name, int version) {
+	return name.substr(0, name.size() - 4) + ".v" + std::to_string(version) + ".csv";
+}
+
+// Shortest representation that round-trips, so small-priced assets keep all digits
+void append_double(std::string &out, double v) {
+	if (is_null(v)) return;
+	char buf[32];
+#if defined(__cpp_lib_to_chars)
+	const auto r = std::to_chars(buf, buf + sizeof(buf), v);
+	out.append(buf, r.ptr);
+#else
+	const int n = std::snprintf(buf, sizeof(buf), "%.17g", v);
+	out.append(buf, static_cast<std::size_t>(n));
+#endif
+}
+
+void append_int(std::string &out, std::int64_t v) {
+	char buf[24];
+	const auto r = std::to_chars(buf, buf + sizeof(buf), v);
+	out.append(buf, r.ptr);
+}
+
+void append_row(std::string &out, const MinuteSnapshot &row) {
+	append_int(out, bucket_key(row));
+	out += ',';
+	out += row.exchange;
+	out += ',';
+	out += row.symbol;
+	// Fixed-point columns print exactly the decimals the exchange sent
+	const int price = row.scale.price;
+	const int qty = row.scale.qty;
+	for (const auto &[v, scale] : { std::pair{row.last_price, price}, std::pair{row.best_bid_price, price},
+			std::pair{row.best_bid_amount, qty}, std::pair{row.best_ask_price, price}, std::pair{row.best_ask_amount, qty},
+			std::pair{row.open, price}, std::pair{row.high, price}, std::pair{row.low, price}, std::pair{row.close, price} }) {
+		out += ',';
+		append_fixed(out, v, scale);
+	}
+	out += ',';
+	append_int(out, row.tick_count);
+	out += ',';
+	append_double(out, row.twap_mid);
+	out += ',';
+	append_fixed(out, row.spread_min, price);
+	out += ',';
+	append_fixed(out, row.spread_max, price);
+	out += ',';
+	append_double(out, row.spread_mean);
+	out += '\n';
+}
+
+// Writes and empties data. On failure data keeps only what was not written,
+// so the next batch resumes the file where it stopped instead of writing
+// the same rows twice.
+void flush(int fd, std::string &data) {
+	std::size_t done = 0;
+	while (done < data.size()) {
+		const ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			const int err = errno;
+			data.erase(0, done);
+			throw std::system_error(err, std::generic_category(), "CSV write");
+		}
+		done += static_cast<std::size_t>(n);
+	}
+	data.clear();
+}
+
+}
+
+CsvWriter::CsvWriter(std::string directory, FsyncPolicy fsync, std::size_t max_open_files)
+	: dir_(std::move(directory)), fsync_(fsync), max_open_files_(max_open_files) {}
+
+CsvWriter::~CsvWriter() {
+	for (auto &kv : files_) {
+		if (kv.second.fd >= 0) ::close(kv.second.fd);
+	}
+}
 
 void CsvWriter::ensure_schema() {
 	fs::create_directories(dir_);
 }
 
-static std::string file_name_for(const MinuteSnapshot &row) {
-	// One file per exchange+symbol, e.g., binance_BTCUSDT.csv
-	return row.exchange + "_" + row.symbol + ".csv";
+CsvWriter::File &CsvWriter::file_for(const MinuteSnapshot &row) {
+	const std::string name = file_name_for(row);
+	File &f = files_[name];
+	f.last_batch = batch_;
+	if (f.fd >= 0) return f;
+	const std::string header = std::string(bucket_key_column(row)) + kHeaderColumns;
+	// A file written with other columns (an older release) is left as it is;
+	// rows go to the first "<name>.vN.csv" that is new or has this header
+	fs::path path = dir_ / name;
+	for (int version = 2;; ++version) {
+		const std::string existing = header_line(path);
+		if (existing.empty() || existing + '\n' == header) break;
+		const fs::path next = dir_ / versioned_name(name, version);
+		std::cerr << "CSV " << path.string() << " has other columns; writing to " << next.string() << "\n";
+		path = next;
+	}
+	f.fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	if (f.fd < 0) throw std::system_error(errno, std::generic_category(), "open " + path.string());
+	struct stat st{};
+	if (::fstat(f.fd, &st) == 0 && st.st_size == 0) f.buffer += header;
+	return f;
 }
 
 void CsvWriter::write_batch(const std::vector<MinuteSnapshot>& rows) {
-	for (const auto &row : rows) {
-		fs::path file = dir_ / file_name_for(row);
-		bool exists = fs::exists(file);
-		std::ofstream out(file, std::ios::app);
-		if (!exists) {
-			out << "minute_unix,exchange,symbol,last_price,best_bid_price,best_bid_amount,best_ask_price,best_ask_amount\n";
+	const StorageMetrics::Batch batch(metrics_, rows.size());
+	++batch_;
+	for (const auto &row : rows) append_row(file_for(row).buffer, row);
+	for (auto &kv : files_) {
+		File &f = kv.second;
+		if (f.buffer.empty()) continue;
+		flush(f.fd, f.buffer);
+		if (fsync_ == FsyncPolicy::EveryBatch) {
+#ifdef __APPLE__
+			::fsync(f.fd);
+#else
+			::fdatasync(f.fd);
+#endif
 		}
-		out << row.minute_unix << ','
-			<< row.exchange << ','
-			<< row.symbol << ','
-			<< (row.last_price ? std::to_string(*row.last_price) : "") << ','
-			<< (row.best_bid_price ? std::to_string(*row.best_bid_price) : "") << ','
-			<< (row.best_bid_amount ? std::to_string(*row.best_bid_amount) : "") << ','
-			<< (row.best_ask_price ? std::to_string(*row.best_ask_price) : "") << ','
-			<< (row.best_ask_amount ? std::to_string(*row.best_ask_amount) : "")
-			<< "\n";
 	}
-	// rely on RAII to close files
+	close_idle_files();
 }
 
+// Every symbol x width keeps a descriptor; past the cap the least recently
+// written files are closed and reopened (header check included) on their next row
+void CsvWriter::close_idle_files() {
+	if (files_.size() <= max_open_files_) return;
+	std::vector<std::pair<std::uint64_t, std::string>> by_age;
+	by_age.reserve(files_.size());
+	for (const auto &kv : files_) by_age.emplace_back(kv.second.last_batch, kv.first);
+	std::sort(by_age.begin(), by_age.end());
+	for (std::size_t i = 0; i < by_age.size() && files_.size() > max_open_files_; ++i) {
+		auto it = files_.find(by_age[i].second);
+		if (!it->second.buffer.empty()) continue; // holds rows a failed write left behind
+		::close(it->second.fd);
+		files_.erase(it);
+	}
 }
 
-
+}
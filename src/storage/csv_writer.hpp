@@ -1,21 +1,51 @@
 #pragma once
 
 #include "storage_writer.hpp"
+#include "storage_metrics.hpp"
 #include <string>
 #include <filesystem>
+#include <unordered_map>
 
 namespace strategia {
 
+enum class FsyncPolicy {
+	Never,     // leave flushing to the OS page cache
+	EveryBatch // fdatasync each touched file at the end of write_batch
+};
+
+// One CSV file per exchange+symbol and bucket width (see bucket_suffix). Files
+// stay open between batches, up to max_open_files (least recently written are
+// closed first); each batch is formatted into per-file buffers and written
+// with one write() per file. An existing file whose header is not the current
+// one is never appended to: rows go to "<name>.v2.csv" (v3, ...).
 class CsvWriter final : public StorageWriter {
 public:
-	explicit CsvWriter(std::string directory);
+	// At most max_open_files descriptors stay open between batches
+	explicit CsvWriter(std::string directory, FsyncPolicy fsync = FsyncPolicy::Never,
+		std::size_t max_open_files = 256);
+	~CsvWriter() override;
+	CsvWriter(const CsvWriter&) = delete;
+	CsvWriter &operator=(const CsvWriter&) = delete;
+
 	void ensure_schema() override;
 	void write_batch(const std::vector<MinuteSnapshot>& rows) override;
 
 private:
+	struct File {
+		int fd = -1;
+		std::string buffer; // pending rows; capacity is kept between batches
+		std::uint64_t last_batch = 0;
+	};
+
+	File &file_for(const MinuteSnapshot &row);
+	void close_idle_files();
+
 	std::filesystem::path dir_;
+	FsyncPolicy fsync_;
+	std::size_t max_open_files_;
+	std::uint64_t batch_ = 0;
+	StorageMetrics metrics_{"csv"};
+	std::unordered_map<std::string, File> files_; // by file name
 };
 
 }
-
-
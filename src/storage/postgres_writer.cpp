@@ -1,10 +1,73 @@
 #include "postgres_writer.hpp"
+#include <algorithm>
+#include <optional>
 
 namespace strategia {
 
+namespace {
+
+// Shared by the prepared INSERT and the staging merge
+constexpr const char *kUpdateSet =
+	" DO UPDATE SET "
+	"last_price = EXCLUDED.last_price, "
+	"best_bid_price = EXCLUDED.best_bid_price, "
+	"best_bid_amount = EXCLUDED.best_bid_amount, "
+	"best_ask_price = EXCLUDED.best_ask_price, "
+	"best_ask_amount = EXCLUDED.best_ask_amount, "
+	"open = EXCLUDED.open, "
+	"high = EXCLUDED.high, "
+	"low = EXCLUDED.low, "
+	"close = EXCLUDED.close, "
+	"tick_count = EXCLUDED.tick_count, "
+	"twap_mid = EXCLUDED.twap_mid, "
+	"spread_min = EXCLUDED.spread_min, "
+	"spread_max = EXCLUDED.spread_max, "
+	"spread_mean = EXCLUDED.spread_mean";
+
+// Follow the key column
+constexpr const char *kValueColumns =
+	"exchange, symbol, last_price, best_bid_price, best_bid_amount, best_ask_price, best_ask_amount, "
+	"open, high, low, close, tick_count, twap_mid, spread_min, spread_max, spread_mean";
+
+std::string columns(const std::string &key) { return key + ", " + kValueColumns; }
+
+std::string on_conflict(const std::string &key) {
+	return " ON CONFLICT (" + key + ", exchange, symbol)" + kUpdateSet;
+}
+
+// Fixed-point values go over as exact decimal text, which the server
+// rounds into DOUBLE PRECISION once
+std::optional<std::string> fixed_param(std::int64_t v, int scale) {
+	if (is_null(v)) return std::nullopt;
+	return fixed_to_string(v, scale);
+}
+
+std::optional<double> mean_param(double v) {
+	if (is_null(v)) return std::nullopt;
+	return v;
+}
+
+// Calls fn with the key column and kValueColumns of r
+template <class Fn>
+void with_params(const MinuteSnapshot &r, Fn &&fn) {
+	const int price = r.scale.price;
+	const int qty = r.scale.qty;
+	fn(bucket_key(r), r.exchange, r.symbol, fixed_param(r.last_price, price), fixed_param(r.best_bid_price, price),
+		fixed_param(r.best_bid_amount, qty), fixed_param(r.best_ask_price, price), fixed_param(r.best_ask_amount, qty),
+		fixed_param(r.open, price), fixed_param(r.high, price), fixed_param(r.low, price), fixed_param(r.close, price),
+		r.tick_count, mean_param(r.twap_mid), fixed_param(r.spread_min, price), fixed_param(r.spread_max, price),
+		mean_param(r.spread_mean));
+}
+
+}
+
+PostgresWriter::Table PostgresWriter::table_for(const MinuteSnapshot &row) {
+	if (is_minute_row(row)) return Table{"minute_snapshots", "minute_unix"};
+	return Table{"snapshots" + bucket_suffix(row), bucket_key_column(row)};
+}
+
 void PostgresWriter::ensure_schema() {
-	pqxx::connection conn(dsn_);
-	pqxx::work tx(conn);
+	pqxx::work tx(connection());
 	tx.exec(R"SQL(
 CREATE TABLE IF NOT EXISTS minute_snapshots (
     minute_unix BIGINT NOT NULL,
@@ -17,38 +80,101 @@ CREATE TABLE IF NOT EXISTS minute_snapshots (
     best_ask_amount DOUBLE PRECISION,
     PRIMARY KEY (minute_unix, exchange, symbol)
 );
+ALTER TABLE minute_snapshots
+    ADD COLUMN IF NOT EXISTS open DOUBLE PRECISION,
+    ADD COLUMN IF NOT EXISTS high DOUBLE PRECISION,
+    ADD COLUMN IF NOT EXISTS low DOUBLE PRECISION,
+    ADD COLUMN IF NOT EXISTS close DOUBLE PRECISION,
+    ADD COLUMN IF NOT EXISTS tick_count BIGINT NOT NULL DEFAULT 0,
+    ADD COLUMN IF NOT EXISTS twap_mid DOUBLE PRECISION,
+    ADD COLUMN IF NOT EXISTS spread_min DOUBLE PRECISION,
+    ADD COLUMN IF NOT EXISTS spread_max DOUBLE PRECISION,
+    ADD COLUMN IF NOT EXISTS spread_mean DOUBLE PRECISION;
 )SQL");
 	tx.commit();
 }
 
-void PostgresWriter::write_batch(const std::vector<MinuteSnapshot>& rows) {
-	if (rows.empty()) return;
-	pqxx::connection conn(dsn_);
-	pqxx::work tx(conn);
-	for (const auto &row : rows) {
-		// upsert
-		auto last_price = row.last_price ? std::to_string(*row.last_price) : "NULL";
-		auto bbp = row.best_bid_price ? std::to_string(*row.best_bid_price) : "NULL";
-		auto bba = row.best_bid_amount ? std::to_string(*row.best_bid_amount) : "NULL";
-		auto bap = row.best_ask_price ? std::to_string(*row.best_ask_price) : "NULL";
-		auto baa = row.best_ask_amount ? std::to_string(*row.best_ask_amount) : "NULL";
-		tx.exec(
-			"INSERT INTO minute_snapshots (minute_unix, exchange, symbol, last_price, best_bid_price, best_bid_amount, best_ask_price, best_ask_amount) VALUES (" +
-			std::to_string(row.minute_unix) + ", " +
-			tx.quote(row.exchange) + ", " +
-			tx.quote(row.symbol) + ", " +
-			last_price + ", " + bbp + ", " + bba + ", " + bap + ", " + baa +
-			") ON CONFLICT (minute_unix, exchange, symbol) DO UPDATE SET "
-			"last_price = EXCLUDED.last_price, "
-			"best_bid_price = EXCLUDED.best_bid_price, "
-			"best_bid_amount = EXCLUDED.best_bid_amount, "
-			"best_ask_price = EXCLUDED.best_ask_price, "
-			"best_ask_amount = EXCLUDED.best_ask_amount"
-		);
+pqxx::connection &PostgresWriter::connection() {
+	if (conn_ && conn_->is_open()) return *conn_;
+	conn_ = std::make_unique<pqxx::connection>(dsn_);
+	// Session-scoped state, recreated on every (re)connect
+	prepared_.clear();
+	return *conn_;
+}
+
+std::string PostgresWriter::prepare_table(const Table &t) {
+	pqxx::connection &conn = connection();
+	const std::string statement = "upsert_" + t.name;
+	if (prepared_.count(t.name)) return statement;
+	if (t.name != "minute_snapshots" && !created_.count(t.name)) {
+		pqxx::work tx(conn);
+		tx.exec("CREATE TABLE IF NOT EXISTS " + t.name + " (" + t.key + " BIGINT NOT NULL, "
+			"exchange TEXT NOT NULL, symbol TEXT NOT NULL, "
+			"last_price DOUBLE PRECISION, best_bid_price DOUBLE PRECISION, best_bid_amount DOUBLE PRECISION, "
+			"best_ask_price DOUBLE PRECISION, best_ask_amount DOUBLE PRECISION, "
+			"open DOUBLE PRECISION, high DOUBLE PRECISION, low DOUBLE PRECISION, close DOUBLE PRECISION, "
+			"tick_count BIGINT NOT NULL DEFAULT 0, twap_mid DOUBLE PRECISION, "
+			"spread_min DOUBLE PRECISION, spread_max DOUBLE PRECISION, spread_mean DOUBLE PRECISION, "
+			"PRIMARY KEY (" + t.key + ", exchange, symbol))");
+		tx.commit();
+		created_.insert(t.name);
 	}
-	tx.commit();
+	conn.prepare(statement, "INSERT INTO " + t.name + " (" + columns(t.key) + ") VALUES "
+		"($1, $2, $3, $4, $5, $6, $7, $8, $9, $10, $11, $12, $13, $14, $15, $16, $17)" + on_conflict(t.key));
+	prepared_.insert(t.name);
+	return statement;
 }
 
+void PostgresWriter::write_chunk(const Table &t, const MinuteSnapshot *rows, std::size_t n) {
+	const std::string statement = prepare_table(t);
+	const std::string staging = t.name + "_staging";
+	pqxx::work tx(connection());
+	if (opts_.use_copy) {
+		// No PK on the staging table: duplicates within a chunk are resolved by
+		// the merge. ord numbers rows in COPY order so the last one can win.
+		tx.exec("CREATE TEMP TABLE IF NOT EXISTS " + staging + " "
+			"(LIKE " + t.name + " INCLUDING DEFAULTS, ord BIGSERIAL) ON COMMIT DELETE ROWS");
+		{
+			auto stream = pqxx::stream_to::table(tx, {staging}, {
+				t.key, "exchange", "symbol", "last_price", "best_bid_price", "best_bid_amount", "best_ask_price", "best_ask_amount",
+				"open", "high", "low", "close", "tick_count", "twap_mid", "spread_min", "spread_max", "spread_mean"});
+			for (std::size_t i = 0; i < n; ++i) {
+				with_params(rows[i], [&](const auto &...v) { stream.write_values(v...); });
+			}
+			stream.complete();
+		}
+		// DISTINCT ON: a single INSERT ... ON CONFLICT cannot touch the same key
+		// twice. Ordering by ord DESC keeps the latest row of a key, as the
+		// row-by-row upsert does.
+		const std::string key = t.key + ", exchange, symbol";
+		tx.exec("INSERT INTO " + t.name + " (" + columns(t.key) + ") "
+			"SELECT DISTINCT ON (" + key + ") " + columns(t.key) + " FROM " + staging
+			+ " ORDER BY " + key + ", ord DESC" + on_conflict(t.key));
+	} else {
+		for (std::size_t i = 0; i < n; ++i) {
+			with_params(rows[i], [&](const auto &...v) { tx.exec_prepared(statement, v...); });
+		}
+	}
+	tx.commit();
 }
 
+void PostgresWriter::write_batch(const std::vector<MinuteSnapshot>& rows) {
+	const StorageMetrics::Batch batch(metrics_, rows.size());
+	const std::size_t chunk = std::max<std::size_t>(opts_.rows_per_commit, 1);
+	for (std::size_t off = 0; off < rows.size();) {
+		// Chunks never span bucket widths: each width has its own table
+		const Table t = table_for(rows[off]);
+		std::size_t n = 1;
+		while (n < chunk && off + n < rows.size() && rows[off + n].bucket_width_ms == rows[off].bucket_width_ms) ++n;
+		try {
+			write_chunk(t, rows.data() + off, n);
+		} catch (const pqxx::broken_connection &) {
+			// One retry on a fresh connection; a second failure propagates
+			conn_.reset();
+			write_chunk(t, rows.data() + off, n);
+		}
+		off += n;
+	}
+}
 
+}
@@ -1,23 +1,52 @@
 #pragma once
 
 #include "storage_writer.hpp"
+#include "storage_metrics.hpp"
 #include <pqxx/pqxx>
 #include <memory>
+#include <set>
+#include <string>
 
 namespace strategia {
 
+struct PostgresOptions {
+	// COPY each chunk into a temp staging table and merge it with one upsert;
+	// otherwise one prepared upsert per row
+	bool use_copy = true;
+	// Rows per transaction; a batch larger than this is committed in chunks
+	std::size_t rows_per_commit = 5000;
+};
+
+// Keeps one connection for the writer's lifetime and reconnects (re-preparing
+// statements and the staging table) when it breaks. One-minute rows go to
+// minute_snapshots; other bucket widths to snapshots_<width> (e.g.
+// snapshots_1s), created on first use and keyed by bucket_start_ms.
 class PostgresWriter final : public StorageWriter {
 public:
-	explicit PostgresWriter(std::string dsn)
-		: dsn_(std::move(dsn)) {}
+	explicit PostgresWriter(std::string dsn, PostgresOptions opts = {})
+		: dsn_(std::move(dsn)), opts_(opts) {}
 
 	void ensure_schema() override;
 	void write_batch(const std::vector<MinuteSnapshot>& rows) override;
 
 private:
+	struct Table {
+		std::string name;
+		std::string key; // first primary key column
+	};
+
+	static Table table_for(const MinuteSnapshot &row);
+	pqxx::connection &connection();
+	// Creates the table if needed and returns its prepared upsert
+	std::string prepare_table(const Table &t);
+	void write_chunk(const Table &t, const MinuteSnapshot *rows, std::size_t n);
+
 	std::string dsn_;
+	PostgresOptions opts_;
+	StorageMetrics metrics_{"postgres"};
+	std::unique_ptr<pqxx::connection> conn_;
+	std::set<std::string> created_;  // tables known to exist
+	std::set<std::string> prepared_; // tables with an upsert on conn_
 };
 
 }
-
-
@@ -0,0 +1,30 @@
+#include "storage_factory.hpp"
+#include "csv_writer.hpp"
+#include "columnar_writer.hpp"
+#ifdef STRATEGIA_ENABLE_POSTGRES
+#include "postgres_writer.hpp"
+#endif
+
+namespace strategia {
+
+std::unique_ptr<StorageWriter> make_storage_writer(const Config &cfg) {
+	std::unique_ptr<StorageWriter> writer;
+#ifdef STRATEGIA_ENABLE_POSTGRES
+	if (cfg.enable_postgres && !cfg.postgres_dsn.empty()) {
+		PostgresOptions opts;
+		opts.use_copy = cfg.postgres_use_copy;
+		opts.rows_per_commit = cfg.postgres_rows_per_commit;
+		writer = std::make_unique<PostgresWriter>(cfg.postgres_dsn, opts);
+	}
+#endif
+	if (!writer && !cfg.columnar_output_dir.empty()) {
+		writer = std::make_unique<ColumnarWriter>(cfg.columnar_output_dir);
+	}
+	if (!writer) {
+		writer = std::make_unique<CsvWriter>(cfg.csv_output_dir, cfg.csv_fsync ? FsyncPolicy::EveryBatch : FsyncPolicy::Never);
+	}
+	writer->ensure_schema();
+	return writer;
+}
+
+}
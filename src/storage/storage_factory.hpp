@@ -0,0 +1,13 @@
+#pragma once
+
+#include "config.hpp"
+#include "storage_writer.hpp"
+#include <memory>
+
+namespace strategia {
+
+// Postgres when enabled (and built in), else columnar when a directory is
+// set, else CSV. The schema is ensured before returning.
+std::unique_ptr<StorageWriter> make_storage_writer(const Config &cfg);
+
+}
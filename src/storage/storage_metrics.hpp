@@ -0,0 +1,46 @@
+#pragma once
+
+#include "metrics/metrics_registry.hpp"
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <string>
+
+namespace strategia {
+
+// write_batch() timings and outcomes of one writer, in the global registry
+struct StorageMetrics {
+	explicit StorageMetrics(const std::string &writer)
+		: duration(MetricsRegistry::global().histogram("strategia_storage_write_duration_seconds",
+			"StorageWriter::write_batch duration", {{"writer", writer}}))
+		, rows(MetricsRegistry::global().counter("strategia_storage_rows_written_total",
+			"Rows handed to a successful write_batch", {{"writer", writer}}))
+		, errors(MetricsRegistry::global().counter("strategia_storage_write_errors_total",
+			"write_batch calls that threw", {{"writer", writer}})) {}
+
+	// Scoped over a write_batch body: a batch left by an exception counts as an error
+	class Batch {
+	public:
+		Batch(StorageMetrics &m, std::size_t rows)
+			: m_(m), rows_(rows), exceptions_(std::uncaught_exceptions()), start_(std::chrono::steady_clock::now()) {}
+		~Batch() {
+			m_.duration.observe_ns(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count());
+			if (std::uncaught_exceptions() > exceptions_) m_.errors.inc();
+			else m_.rows.inc(rows_);
+		}
+		Batch(const Batch&) = delete;
+		Batch &operator=(const Batch&) = delete;
+
+	private:
+		StorageMetrics &m_;
+		std::size_t rows_;
+		int exceptions_;
+		std::chrono::steady_clock::time_point start_;
+	};
+
+	DurationHistogram &duration;
+	Counter &rows;
+	Counter &errors;
+};
+
+}
@@ -1,23 +1,53 @@
 #pragma once
 
+#include "fixed_point.hpp"
+#include "time_utils.hpp"
+#include <cstdint>
 #include <string>
 #include <vector>
-#include <optional>
 
 namespace strategia {
 
 struct MinuteSnapshot {
-	std::int64_t minute_unix = 0; // start of minute (unix sec)
+	std::int64_t minute_unix = 0; // start of the bucket (unix sec)
+	std::int64_t bucket_start_ms = 0; // start of the bucket (unix ms)
+	std::int64_t bucket_width_ms = kMinuteMs;
 	std::string exchange;
 	std::string symbol;
-	std::optional<double> last_price;
+	// Prices and amounts are fixed point at the instrument's scale,
+	// kNullFixed if unknown; the averages are double, NaN if unknown
+	FixedScale scale;
+	std::int64_t last_price = kNullFixed;
 	// Best levels (if available)
-	std::optional<double> best_bid_price;
-	std::optional<double> best_bid_amount;
-	std::optional<double> best_ask_price;
-	std::optional<double> best_ask_amount;
+	std::int64_t best_bid_price = kNullFixed;
+	std::int64_t best_bid_amount = kNullFixed;
+	std::int64_t best_ask_price = kNullFixed;
+	std::int64_t best_ask_amount = kNullFixed;
+	// Statistics over the whole minute (see BucketStats)
+	std::int64_t open = kNullFixed;
+	std::int64_t high = kNullFixed;
+	std::int64_t low = kNullFixed;
+	std::int64_t close = kNullFixed;
+	std::int64_t tick_count = 0;
+	double twap_mid = kNullDouble;
+	std::int64_t spread_min = kNullFixed;
+	std::int64_t spread_max = kNullFixed;
+	double spread_mean = kNullDouble;
+	// Weights for merging rows into coarser buckets (see RollupPipeline); not stored
+	std::int64_t quote_count = 0;
+	std::int64_t twap_ms = 0; // time twap_mid was averaged over
 };
 
+// Each bucket width is stored separately. One-minute rows keep the original
+// layout keyed by minute_unix; other widths are keyed by bucket_start_ms in
+// files/tables named with a suffix such as "_100ms" or "_5m".
+inline bool is_minute_row(const MinuteSnapshot &r) { return r.bucket_width_ms == kMinuteMs; }
+inline std::string bucket_suffix(const MinuteSnapshot &r) {
+	return is_minute_row(r) ? std::string() : "_" + duration_label(r.bucket_width_ms);
+}
+inline const char *bucket_key_column(const MinuteSnapshot &r) { return is_minute_row(r) ? "minute_unix" : "bucket_start_ms"; }
+inline std::int64_t bucket_key(const MinuteSnapshot &r) { return is_minute_row(r) ? r.minute_unix : r.bucket_start_ms; }
+
 class StorageWriter {
 public:
 	virtual ~StorageWriter() = default;
@@ -2,6 +2,9 @@
 
 #include <chrono>
 #include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
 
 namespace strategia {
 
@@ -13,8 +16,62 @@ inline std::int64_t current_unix_seconds() {
 	return to_unix_seconds(std::chrono::system_clock::now());
 }
 
-inline std::int64_t minute_bucket_unix(std::int64_t unix_seconds) {
-	return (unix_seconds / 60) * 60;
+// Wall clock in ns; comparable with exchange event timestamps and across threads
+inline std::int64_t current_unix_nanos() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+inline std::int64_t current_unix_millis() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+inline constexpr std::int64_t kMinuteMs = 60000;
+
+// Half-open wall-clock interval [start_ms, start_ms + width_ms) in unix ms;
+// buckets are aligned to multiples of their width since the epoch
+struct TimeBucket {
+	std::int64_t start_ms = 0;
+	std::int64_t width_ms = kMinuteMs;
+
+	std::int64_t end_ms() const { return start_ms + width_ms; }
+	bool operator==(const TimeBucket &o) const { return start_ms == o.start_ms && width_ms == o.width_ms; }
+};
+
+inline TimeBucket bucket_at(std::int64_t unix_ms, std::int64_t width_ms) {
+	return TimeBucket{ unix_ms - unix_ms % width_ms, width_ms };
+}
+
+// "100ms", "1s", "5m", "1h", "1d": the largest unit that divides the width
+inline std::string duration_label(std::int64_t ms) {
+	static constexpr std::pair<std::int64_t, const char*> units[] = {
+		{86400000, "d"}, {3600000, "h"}, {60000, "m"}, {1000, "s"}};
+	for (const auto &u : units) {
+		if (ms % u.first == 0) return std::to_string(ms / u.first) + u.second;
+	}
+	return std::to_string(ms) + "ms";
+}
+
+// Inverse of duration_label; a bare number is milliseconds.
+// Throws std::invalid_argument on anything else.
+inline std::int64_t parse_duration_ms(const std::string &text) {
+	std::size_t pos = 0;
+	long long n = 0;
+	try {
+		n = std::stoll(text, &pos);
+	} catch (const std::exception &) {
+		throw std::invalid_argument("bad duration: " + text);
+	}
+	const std::string unit = text.substr(pos);
+	std::int64_t scale = 0;
+	if (unit.empty() || unit == "ms") scale = 1;
+	else if (unit == "s") scale = 1000;
+	else if (unit == "m") scale = 60000;
+	else if (unit == "h") scale = 3600000;
+	else if (unit == "d") scale = 86400000;
+	if (scale == 0 || n <= 0) throw std::invalid_argument("bad duration: " + text);
+	return n * scale;
 }
 
 }